@@ -120,6 +120,17 @@ static void llvm_str(LLVMValueRef *chars, size_t n, const char *str)
       chars[i] = llvm_int8(*str ? *(str++) : '\0');
 }
 
+static LLVMTypeRef llvm_tmp_stack_type(void)
+{
+   // Matches tmp_stack_t in the runtime
+
+   LLVMTypeRef fields[] = {
+      llvm_void_ptr(),    // Base
+      LLVMInt32Type()     // Bytes allocated
+   };
+   return LLVMStructType(fields, ARRAY_LEN(fields), false);
+}
+
 static LLVMTypeRef llvm_uarray_type(LLVMTypeRef base, int dims)
 {
    // Unconstrained arrays are represented by a structure
@@ -311,8 +322,14 @@ static LLVMValueRef cgen_get_var(vcode_var_t var, cgen_ctx_t *ctx)
 
 static LLVMValueRef cgen_tmp_alloc(LLVMValueRef bytes, LLVMTypeRef type)
 {
-   LLVMValueRef _tmp_stack_ptr = LLVMGetNamedGlobal(module, "_tmp_stack");
-   LLVMValueRef _tmp_alloc_ptr = LLVMGetNamedGlobal(module, "_tmp_alloc");
+   // The runtime returns the temporary stack for the current thread
+   LLVMValueRef tmp_stack =
+      LLVMBuildCall(builder, llvm_fn("_tmp_stack"), NULL, 0, "tmp_stack");
+
+   LLVMValueRef _tmp_stack_ptr =
+      LLVMBuildStructGEP(builder, tmp_stack, 0, "tmp_stack_ptr");
+   LLVMValueRef _tmp_alloc_ptr =
+      LLVMBuildStructGEP(builder, tmp_stack, 1, "tmp_alloc_ptr");
 
    LLVMValueRef alloc = LLVMBuildLoad(builder, _tmp_alloc_ptr, "alloc");
    LLVMValueRef stack = LLVMBuildLoad(builder, _tmp_stack_ptr, "stack");
@@ -2718,13 +2735,82 @@ static LLVMTypeRef cgen_state_type(cgen_ctx_t *ctx)
    return LLVMStructType(fields, nfields, false);
 }
 
-static void cgen_state_struct(cgen_ctx_t *ctx)
+static bool cgen_type_is_flat(vcode_type_t type)
+{
+   // True if a value of this type contains no pointers and so can be
+   // saved and restored as raw bytes
+
+   switch (vtype_kind(type)) {
+   case VCODE_TYPE_INT:
+   case VCODE_TYPE_REAL:
+   case VCODE_TYPE_OFFSET:
+      return true;
+
+   case VCODE_TYPE_CARRAY:
+      return cgen_type_is_flat(vtype_elem(type));
+
+   case VCODE_TYPE_RECORD:
+      {
+         const int nfields = vtype_fields(type);
+         for (int i = 0; i < nfields; i++) {
+            if (!cgen_type_is_flat(vtype_field(type, i)))
+               return false;
+         }
+         return true;
+      }
+
+   default:
+      return false;
+   }
+}
+
+static LLVMTypeRef llvm_state_entry_type(void)
 {
+   // Matches proc_state_entry_t in the runtime
+
+   LLVMTypeRef fields[] = {
+      llvm_void_ptr(),    // State struct
+      LLVMInt64Type(),    // Size in bytes
+      LLVMInt8Type()      // True if it can be copied as raw bytes
+   };
+   return LLVMStructType(fields, ARRAY_LEN(fields), false);
+}
+
+static LLVMValueRef cgen_state_struct(cgen_ctx_t *ctx)
+{
+   // Returns an entry for the state table used by simulation checkpoints
+
    char *name LOCAL = xasprintf("%s__state", istr(vcode_unit_name()));
    LLVMTypeRef state_ty = cgen_state_type(ctx);
    ctx->state = LLVMAddGlobal(module, state_ty, name);
    LLVMSetLinkage(ctx->state, LLVMInternalLinkage);
    LLVMSetInitializer(ctx->state, LLVMGetUndef(state_ty));
+
+   bool flat = true;
+   const int nvars = vcode_count_vars();
+   for (int i = 0; (i < nvars) && flat; i++)
+      flat = cgen_type_is_flat(vcode_var_type(vcode_var_handle(i)));
+
+   LLVMValueRef fields[] = {
+      LLVMConstBitCast(ctx->state, llvm_void_ptr()),
+      LLVMSizeOf(state_ty),
+      llvm_int8(flat)
+   };
+   return LLVMConstStruct(fields, ARRAY_LEN(fields), false);
+}
+
+static void cgen_state_table(tree_t top, LLVMValueRef *entries, int count)
+{
+   // One entry for each process in statement order so the runtime can
+   // find the state structs without them being exported
+
+   LLVMTypeRef entry_ty = llvm_state_entry_type();
+   LLVMTypeRef table_ty = LLVMArrayType(entry_ty, count);
+
+   char *name LOCAL = xasprintf("%s__state_table", istr(tree_ident(top)));
+   LLVMValueRef table = LLVMAddGlobal(module, table_ty, name);
+   LLVMSetGlobalConstant(table, true);
+   LLVMSetInitializer(table, LLVMConstArray(entry_ty, entries, count));
 }
 
 static void cgen_jump_table(cgen_ctx_t *ctx)
@@ -2836,7 +2922,7 @@ static void cgen_procedure(LLVMTypeRef display_type)
    cgen_free_context(&ctx);
 }
 
-static void cgen_process(vcode_unit_t code)
+static LLVMValueRef cgen_process(vcode_unit_t code)
 {
    vcode_select_unit(code);
    assert(vcode_unit_kind() == VCODE_UNIT_PROCESS);
@@ -2853,7 +2939,7 @@ static void cgen_process(vcode_unit_t code)
    cgen_ctx_t ctx = {
       .fn = fn
    };
-   cgen_state_struct(&ctx);
+   LLVMValueRef state_entry = cgen_state_struct(&ctx);
    cgen_alloc_context(&ctx);
 
    // If the parameter is non-zero jump to the init block
@@ -2881,6 +2967,8 @@ static void cgen_process(vcode_unit_t code)
 
    cgen_code(&ctx);
    cgen_free_context(&ctx);
+
+   return state_entry;
 }
 
 static void cgen_net_mapping_table(vcode_signal_t sig, int offset,
@@ -3091,11 +3179,15 @@ static void cgen_top(tree_t t)
 
    if (tree_kind(t) == T_ELAB) {
       const int nstmts = tree_stmts(t);
+      LLVMValueRef *states = xmalloc(sizeof(LLVMValueRef) * MAX(nstmts, 1));
       for (int i = 0; i < nstmts; i++) {
          tree_t p = tree_stmt(t, i);
          cgen_subprograms(p);
-         cgen_process(tree_code(p));
+         states[i] = cgen_process(tree_code(p));
       }
+
+      cgen_state_table(t, states, nstmts);
+      free(states);
    }
 }
 
@@ -3211,6 +3303,16 @@ static LLVMValueRef cgen_support_fn(const char *name)
                            LLVMFunctionType(llvm_void_ptr(),
                                             args, ARRAY_LEN(args), false));
    }
+   else if (strcmp(name, "_tmp_stack") == 0) {
+      fn = LLVMAddFunction(module, "_tmp_stack",
+                           LLVMFunctionType(
+                              LLVMPointerType(llvm_tmp_stack_type(), 0),
+                              NULL, 0, false));
+
+      // Always returns the same pointer for a given thread so repeated
+      // calls within a function can be combined
+      LLVMAddFunctionAttr(fn, LLVMReadNoneAttribute);
+   }
    else if (strcmp(name, "_image") == 0) {
       LLVMTypeRef args[] = {
          LLVMInt64Type(),
@@ -3451,17 +3553,6 @@ static void cgen_module_name(tree_t top)
    LLVMSetLinkage(mod_name, LLVMPrivateLinkage);
 }
 
-static void cgen_tmp_stack(void)
-{
-   LLVMValueRef _tmp_stack =
-      LLVMAddGlobal(module, llvm_void_ptr(), "_tmp_stack");
-   LLVMSetLinkage(_tmp_stack, LLVMExternalLinkage);
-
-   LLVMValueRef _tmp_alloc =
-      LLVMAddGlobal(module, LLVMInt32Type(), "_tmp_alloc");
-   LLVMSetLinkage(_tmp_alloc, LLVMExternalLinkage);
-}
-
 void cgen(tree_t top)
 {
    tree_kind_t kind = tree_kind(top);
@@ -3472,7 +3563,6 @@ void cgen(tree_t top)
    builder = LLVMCreateBuilder();
 
    cgen_module_name(top);
-   cgen_tmp_stack();
 
    cgen_top(top);
 
@@ -697,4 +697,7 @@ void intern_strings(void)
    last_value_i     = ident_new("last_value");
    postponed_i      = ident_new("postponed");
    work_i           = ident_new("WORK");
+   parallel_i       = ident_new("parallel");
+   clock_i          = ident_new("clock");
+   comb_i           = ident_new("comb");
 }
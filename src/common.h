@@ -177,6 +177,9 @@ GLOBAL ident_t last_value_i;
 GLOBAL ident_t builtin_i;
 GLOBAL ident_t postponed_i;
 GLOBAL ident_t work_i;
+GLOBAL ident_t parallel_i;
+GLOBAL ident_t clock_i;
+GLOBAL ident_t comb_i;
 
 void intern_strings();
 
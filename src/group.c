@@ -23,6 +23,16 @@
 
 #include <assert.h>
 #include <stdlib.h>
+#include <stdio.h>
+
+typedef struct group group_t;
+
+struct group {
+   group_t  *next;
+   groupid_t gid;
+   netid_t   first;
+   unsigned  length;
+};
 
 typedef struct {
    group_t   *groups;
@@ -435,24 +445,75 @@ static void group_nets_visit_fn(tree_t t, void *_ctx)
    }
 }
 
+static int group_cmp_first(const void *a, const void *b)
+{
+   const group_t *ga = *(const group_t **)a;
+   const group_t *gb = *(const group_t **)b;
+
+   return (ga->first > gb->first) - (ga->first < gb->first);
+}
+
 static void group_write_netdb(tree_t top, group_nets_ctx_t *ctx)
 {
+   // Group IDs are renumbered in net order which also removes any gaps
+   // left by groups that were split
+
+   unsigned ngroups = 0;
+   netid_t nnets = 0;
+   for (group_t *it = ctx->groups; it != NULL; it = it->next) {
+      ngroups++;
+      nnets = MAX(nnets, it->first + it->length);
+   }
+
+   group_t **sorted = xmalloc(sizeof(group_t *) * MAX(ngroups, 1));
+   unsigned n = 0;
+   for (group_t *it = ctx->groups; it != NULL; it = it->next)
+      sorted[n++] = it;
+
+   qsort(sorted, ngroups, sizeof(group_t *), group_cmp_first);
+
+   netid_t   *first  = xmalloc(sizeof(netid_t) * MAX(ngroups, 1));
+   uint32_t  *length = xmalloc(sizeof(uint32_t) * MAX(ngroups, 1));
+   groupid_t *map    = xmalloc(sizeof(groupid_t) * MAX(nnets, 1));
+
+   for (netid_t i = 0; i < nnets; i++)
+      map[i] = GROUPID_INVALID;
+
+   for (groupid_t gid = 0; gid < ngroups; gid++) {
+      first[gid]  = sorted[gid]->first;
+      length[gid] = sorted[gid]->length;
+
+      for (netid_t i = first[gid]; i < first[gid] + length[gid]; i++)
+         map[i] = gid;
+   }
+
+   const netdb_header_t header = {
+      .magic    = NETDB_MAGIC,
+      .ngroups  = ngroups,
+      .nnets    = nnets,
+      .reserved = 0
+   };
+
    char *name = xasprintf("_%s.netdb", istr(tree_ident(top)));
 
-   fbuf_t *f = lib_fbuf_open(lib_work(), name, FBUF_OUT);
+   FILE *f = lib_fopen(lib_work(), name, "wb");
    if (f == NULL)
       fatal("failed to create net database file %s", name);
 
-   free(name);
+   if ((fwrite(&header, sizeof(header), 1, f) != 1)
+       || (fwrite(first, sizeof(netid_t), ngroups, f) != ngroups)
+       || (fwrite(length, sizeof(uint32_t), ngroups, f) != ngroups)
+       || (fwrite(map, sizeof(groupid_t), nnets, f) != nnets))
+      fatal_errno("writing %s", name);
 
-   for (group_t *it = ctx->groups; it != NULL; it = it->next) {
-      write_u32(it->gid, f);
-      write_u32(it->first, f);
-      write_u32(it->length, f);
-   }
-   write_u32(GROUPID_INVALID, f);
+   if (fclose(f) != 0)
+      fatal_errno("closing %s", name);
 
-   fbuf_close(f);
+   free(name);
+   free(sorted);
+   free(first);
+   free(length);
+   free(map);
 }
 
 void group_nets(tree_t top)
@@ -2725,7 +2725,7 @@ static bool lower_signal_sequential_nets(tree_t decl)
    return (i == nnets) && (nnets > 0);
 }
 
-static void lower_sched_event(tree_t on, bool is_static)
+static void lower_sched_event(tree_t on, bool is_static, unsigned edge)
 {
    tree_kind_t expr_kind = tree_kind(on);
    if (expr_kind != T_REF && expr_kind != T_ARRAY_REF
@@ -2753,7 +2753,7 @@ static void lower_sched_event(tree_t on, bool is_static)
 
    tree_kind_t kind = tree_kind(decl);
    if (kind == T_ALIAS) {
-      lower_sched_event(tree_value(decl), is_static);
+      lower_sched_event(tree_value(decl), is_static, edge);
       return;
    }
    else if (kind != T_SIGNAL_DECL && kind != T_PORT_DECL) {
@@ -2813,11 +2813,92 @@ static void lower_sched_event(tree_t on, bool is_static)
 
    const int flags =
       (sequential ? SCHED_SEQUENTIAL : 0)
-      | (is_static ? SCHED_STATIC : 0);
+      | (is_static ? SCHED_STATIC : 0)
+      | (edge << SCHED_EDGE_SHIFT);
 
    emit_sched_event(nets, n_elems, flags);
 }
 
+static unsigned lower_edge_lits(type_t type, const char *lit1,
+                                const char *lit2)
+{
+   const char *names[] = { lit1, lit2 };
+
+   unsigned mask = 0;
+   for (int i = 0; i < 2; i++) {
+      const unsigned nlits = type_enum_literals(type);
+      for (unsigned j = 0; j < nlits; j++) {
+         if (!icmp(tree_ident(type_enum_literal(type, j)), names[i]))
+            continue;
+         else if (j >= SCHED_EDGE_LITS)
+            return 0;
+         else
+            mask |= (1 << j);
+      }
+   }
+
+   return mask;
+}
+
+static bool lower_is_ref_to(tree_t expr, tree_t decl)
+{
+   return (tree_kind(expr) == T_REF) && (tree_ref(expr) == decl);
+}
+
+static unsigned lower_edge_mask(tree_t value, tree_t decl)
+{
+   // Return a mask of the values of the scalar signal decl that can
+   // make the wait condition value true or zero if any value might.
+   // Recognises S = lit, S'event and S = lit, rising_edge(S), and
+   // falling_edge(S).
+
+   if ((tree_kind(value) != T_FCALL) || (tree_params(value) == 0))
+      return 0;
+
+   tree_t fdecl = tree_ref(value);
+   ident_t builtin = tree_attr_str(fdecl, builtin_i);
+
+   const int nparams = tree_params(value);
+   tree_t p0 = tree_value(tree_param(value, 0));
+   tree_t p1 = (nparams > 1) ? tree_value(tree_param(value, 1)) : NULL;
+
+   if ((builtin != NULL) && icmp(builtin, "eq") && (nparams == 2)) {
+      tree_t lit = lower_is_ref_to(p0, decl) ? p1
+         : (lower_is_ref_to(p1, decl) ? p0 : NULL);
+      if ((lit == NULL) || (tree_kind(lit) != T_REF)
+          || (tree_kind(tree_ref(lit)) != T_ENUM_LIT))
+         return 0;
+
+      const unsigned pos = tree_pos(tree_ref(lit));
+      return (pos < SCHED_EDGE_LITS) ? (1 << pos) : 0;
+   }
+   else if ((builtin != NULL) && icmp(builtin, "and") && (nparams == 2)) {
+      for (int i = 0; i < 2; i++) {
+         tree_t event = (i == 0) ? p0 : p1;
+         tree_t other = (i == 0) ? p1 : p0;
+
+         if ((tree_kind(event) == T_ATTR_REF)
+             && (tree_attr_int(event, builtin_i, -1) == ATTR_EVENT)
+             && lower_is_ref_to(tree_name(event), decl))
+            return lower_edge_mask(other, decl);
+      }
+      return 0;
+   }
+   else if ((builtin == NULL) && (nparams == 1) && lower_is_ref_to(p0, decl)) {
+      type_t type = type_base_recur(tree_type(decl));
+      ident_t name = tree_ident(fdecl);
+
+      if (icmp(name, "IEEE.STD_LOGIC_1164.RISING_EDGE")
+          || icmp(name, "IEEE.NUMERIC_BIT.RISING_EDGE"))
+         return lower_edge_lits(type, "'1'", "'H'");
+      else if (icmp(name, "IEEE.STD_LOGIC_1164.FALLING_EDGE")
+               || icmp(name, "IEEE.NUMERIC_BIT.FALLING_EDGE"))
+         return lower_edge_lits(type, "'0'", "'L'");
+   }
+
+   return 0;
+}
+
 static void lower_wait(tree_t wait)
 {
    const bool is_static = tree_attr_int(wait, static_i, 0);
@@ -2831,8 +2912,19 @@ static void lower_wait(tree_t wait)
    }
 
    const int ntriggers = tree_triggers(wait);
+
+   // A process waiting for an edge on a single clock signal need only
+   // be woken when the signal changes to a value that matches
+   unsigned edge = 0;
+   if (tree_has_value(wait) && (ntriggers == 1)) {
+      tree_t trigger = tree_trigger(wait, 0);
+      if ((tree_kind(trigger) == T_REF)
+          && type_is_enum(tree_type(tree_ref(trigger))))
+         edge = lower_edge_mask(tree_value(wait), tree_ref(trigger));
+   }
+
    for (int i = 0; i < ntriggers; i++)
-      lower_sched_event(tree_trigger(wait, i), is_static);
+      lower_sched_event(tree_trigger(wait, i), is_static, edge);
 
    if (is_static)
       vcode_select_block(active_bb);
@@ -2890,9 +2982,8 @@ static void lower_wait(tree_t wait)
       vcode_select_block(again_bb);
 
       if (!is_static) {
-         const int ntriggers = tree_triggers(wait);
          for (int i = 0; i < ntriggers; i++)
-            lower_sched_event(tree_trigger(wait, i), is_static);
+            lower_sched_event(tree_trigger(wait, i), is_static, edge);
       }
 
       emit_wait(resume, timeout_reg);
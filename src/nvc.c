@@ -361,16 +361,34 @@ static int run(int argc, char **argv)
 {
    static struct option long_options[] = {
       { "trace",         no_argument,       0, 't' },
+      { "trace-file",    required_argument, 0, 'F' },
+      { "trace-proc",    required_argument, 0, 'R' },
+      { "trace-signal",  required_argument, 0, 'G' },
       { "batch",         no_argument,       0, 'b' },
+      { "cache-stats",   no_argument,       0, 'M' },
+      { "checkpoint",    required_argument, 0, 'k' },
+      { "checkpoint-at", required_argument, 0, 'K' },
       { "command",       no_argument,       0, 'c' },
       { "stop-time",     required_argument, 0, 's' },
       { "stats",         no_argument,       0, 'S' },
       { "wave",          optional_argument, 0, 'w' },
       { "stop-delta",    required_argument, 0, 'd' },
       { "format",        required_argument, 0, 'f' },
+      { "fork-batch",    required_argument, 0, 'L' },
+      { "heartbeat",     required_argument, 0, 'B' },
+      { "heartbeat-file", required_argument, 0, 'O' },
+      { "huge-pages",    no_argument,       0, 'H' },
       { "include",       required_argument, 0, 'i' },
+      { "jobs",          required_argument, 0, 'j' },
+      { "levelise",      no_argument,       0, 'E' },
       { "exclude",       required_argument, 0, 'e' },
       { "exit-severity", required_argument, 0, 'x' },
+      { "event-queue",   required_argument, 0, 'Q' },
+      { "threads",       required_argument, 0, 'T' },
+      { "pack-signals",  no_argument,       0, 'P' },
+      { "perf-map",      no_argument,       0, 'm' },
+      { "profile",       optional_argument, 0, 'p' },
+      { "restore",       required_argument, 0, 'r' },
 #if ENABLE_VHPI
       { "load",          required_argument, 0, 'l' },
 #endif
@@ -381,8 +399,13 @@ static int run(int argc, char **argv)
    enum { LXT, FST, VCD} wave_fmt = FST;
 
    uint64_t stop_time = UINT64_MAX;
+   uint64_t checkpoint_at = UINT64_MAX;
    const char *wave_fname = NULL;
    const char *vhpi_plugins = NULL;
+   const char *checkpoint_fname = NULL;
+   const char *restore_fname = NULL;
+   const char *fork_list = NULL;
+   int fork_jobs = 0;
 
    int c, index = 0;
    const char *spec = "bcw::l:";
@@ -397,6 +420,15 @@ static int run(int argc, char **argv)
       case 't':
          opt_set_int("rt_trace_en", 1);
          break;
+      case 'F':
+         opt_set_str("rt-trace-file", optarg);
+         break;
+      case 'R':
+         trace_filter_proc(optarg);
+         break;
+      case 'G':
+         trace_filter_signal(optarg);
+         break;
       case 'b':
          mode = BATCH;
          break;
@@ -440,6 +472,67 @@ static int run(int argc, char **argv)
       case 'x':
          rt_set_exit_severity(parse_severity(optarg));
          break;
+      case 'Q':
+         if (strcmp(optarg, "wheel") == 0)
+            opt_set_int("rt-wheel", 1);
+         else if (strcmp(optarg, "heap") == 0)
+            opt_set_int("rt-wheel", 0);
+         else
+            fatal("invalid event queue: %s", optarg);
+         break;
+      case 'T':
+         {
+            const int threads = parse_int(optarg);
+            if (threads < 0)
+               fatal("invalid number of threads: %s", optarg);
+            opt_set_int("rt-threads", threads);
+         }
+         break;
+      case 'P':
+         opt_set_int("rt-pack", 1);
+         break;
+      case 'M':
+         opt_set_int("rt-cache-stats", 1);
+         break;
+      case 'H':
+         opt_set_int("rt-huge-pages", 1);
+         break;
+      case 'E':
+         opt_set_int("rt-levelise", 1);
+         break;
+      case 'B':
+         {
+            const int secs = parse_int(optarg);
+            if (secs < 0)
+               fatal("invalid heartbeat interval: %s", optarg);
+            opt_set_int("rt-heartbeat", secs);
+         }
+         break;
+      case 'O':
+         opt_set_str("rt-heartbeat-file", optarg);
+         break;
+      case 'm':
+         opt_set_int("rt-perf-map", 1);
+         break;
+      case 'p':
+         opt_set_str("rt-profile", optarg ?: "");
+         break;
+      case 'k':
+         checkpoint_fname = optarg;
+         break;
+      case 'K':
+         checkpoint_at = parse_time(optarg);
+         break;
+      case 'r':
+         restore_fname = optarg;
+         break;
+      case 'L':
+         fork_list = optarg;
+         break;
+      case 'j':
+         if ((fork_jobs = parse_int(optarg)) < 0)
+            fatal("invalid number of jobs: %s", optarg);
+         break;
       default:
          abort();
       }
@@ -486,6 +579,39 @@ static int run(int argc, char **argv)
          free(tmp);
    }
 
+   const char *profile_fname = opt_get_str("rt-profile");
+   if ((profile_fname != NULL) && (*profile_fname == '\0')) {
+      char *tmp = xasprintf("%s.profile.json", argv[optind]);
+      opt_set_str("rt-profile", tmp);
+      free(tmp);
+   }
+
+   if (fork_list != NULL) {
+      if (mode == COMMAND)
+         fatal("--fork-batch cannot be used with --command");
+      else if (wave_fname != NULL)
+         fatal("--fork-batch cannot be used with --wave");
+      else if (opt_get_str("rt-trace-file") != NULL)
+         fatal("--fork-batch cannot be used with --trace-file");
+      else if (opt_get_str("rt-heartbeat-file") != NULL)
+         fatal("--fork-batch cannot be used with --heartbeat-file");
+      else if (opt_get_int("rt-cache-stats"))
+         fatal("--fork-batch cannot be used with --cache-stats");
+
+      // Worker threads do not survive fork
+      opt_set_int("rt-threads", 1);
+   }
+
+   if ((checkpoint_fname != NULL) && (checkpoint_at == UINT64_MAX))
+      fatal("--checkpoint requires --checkpoint-at");
+   else if (checkpoint_at != UINT64_MAX) {
+      char *tmp = NULL;
+      if (checkpoint_fname == NULL)
+         checkpoint_fname = tmp = xasprintf("%s.checkpoint", argv[optind]);
+      rt_set_checkpoint(checkpoint_at, checkpoint_fname);
+      free(tmp);
+   }
+
    rt_start_of_tool(e, ctx);
 
    if (vhpi_plugins != NULL)
@@ -493,6 +619,16 @@ static int run(int argc, char **argv)
 
    rt_restart(e);
 
+   if (restore_fname != NULL)
+      rt_restore(e, restore_fname);
+
+   if (fork_list != NULL) {
+      const int status = rt_fork_batch(e, fork_list, fork_jobs, stop_time);
+      rt_end_of_tool(e);
+      tree_read_end(ctx);
+      return status;
+   }
+
    if (mode == COMMAND)
       shell_run(e, ctx);
    else
@@ -556,6 +692,40 @@ static int make_cmd(int argc, char **argv)
    return EXIT_SUCCESS;
 }
 
+static int decode_trace_cmd(int argc, char **argv)
+{
+   static struct option long_options[] = {
+      { "csv", no_argument, 0, 'c' },
+      { 0, 0, 0, 0 }
+   };
+
+   bool csv = false;
+
+   int c, index = 0;
+   const char *spec = "";
+   optind = 1;
+   while ((c = getopt_long(argc, argv, spec, long_options, &index)) != -1) {
+      switch (c) {
+      case 0:
+         // Set a flag
+         break;
+      case '?':
+         fatal("unrecognised decode-trace option %s", argv[optind - 1]);
+      case 'c':
+         csv = true;
+         break;
+      default:
+         abort();
+      }
+   }
+
+   if (optind == argc)
+      fatal("missing trace file name");
+
+   trace_decode(argv[optind], csv);
+   return EXIT_SUCCESS;
+}
+
 static int dump_cmd(int argc, char **argv)
 {
    static struct option long_options[] = {
@@ -613,6 +783,17 @@ static void set_default_opts(void)
 {
    opt_set_int("rt-stats", 0);
    opt_set_int("rt_trace_en", 0);
+   opt_set_int("rt-wheel", 1);
+   opt_set_int("rt-threads", 1);
+   opt_set_int("rt-pack", 0);
+   opt_set_int("rt-cache-stats", 0);
+   opt_set_int("rt-huge-pages", 0);
+   opt_set_int("rt-levelise", 0);
+   opt_set_str("rt-profile", NULL);
+   opt_set_int("rt-perf-map", 0);
+   opt_set_str("rt-trace-file", NULL);
+   opt_set_int("rt-heartbeat", 0);
+   opt_set_str("rt-heartbeat-file", NULL);
    opt_set_int("dump-llvm", 0);
    opt_set_int("optimise", 1);
    opt_set_int("native", 0);
@@ -637,6 +818,7 @@ static void usage(void)
           " -e [OPTION]... UNIT\t\tElaborate and generate code for UNIT\n"
           " -r [OPTION]... UNIT\t\tExecute previously elaborated UNIT\n"
           " --codegen UNIT\t\t\tGenerate native shared library for UNIT\n"
+          " --decode-trace [OPTION]... FILE\tPrint binary trace FILE\n"
           " --dump [OPTION]... UNIT\tPrint out previously analysed UNIT\n"
           " --make [OPTION]... [UNIT]...\tGenerate makefile to rebuild UNITs\n"
           "\n"
@@ -664,18 +846,36 @@ static void usage(void)
           "\n"
           "Run options:\n"
           " -b, --batch\t\tRun in batch mode (default)\n"
+          "     --cache-stats\tCount CPU cache misses in each cycle\n"
+          "     --checkpoint=FILE\tFile for --checkpoint-at state\n"
+          "     --checkpoint-at=T\tSave simulation state at time T\n"
           " -c, --command\t\tRun in TCL command line mode\n"
+          "     --event-queue=Q\tFuture events kept in heap or wheel\n"
           "     --exclude=GLOB\tExclude signals matching GLOB from wave dump\n"
           "     --exit-severity=S\tExit after assertion failure of severity S\n"
           "     --format=FMT\tWaveform format is one of lxt, fst, or vcd\n"
+          "     --fork-batch=LIST\tFork a child for each test directory\n"
+          "     --heartbeat=N\tPrint progress every N seconds\n"
+          "     --heartbeat-file=F\tWrite progress to F instead of stderr\n"
+          "     --huge-pages\tUse huge pages for runtime memory pools\n"
           "     --include=GLOB\tInclude signals matching GLOB in wave dump\n"
+          "     --jobs=N\t\tRun N --fork-batch tests at once (0 for all)\n"
+          "     --levelise\t\tSettle combinational processes in level order\n"
 #ifdef ENABLE_VHPI
           "     --load=PLUGIN\tLoad VHPI plugin at startup\n"
 #endif
+          "     --pack-signals\tPack transactions and 'LAST_VALUE of vectors\n"
+          "     --perf-map\tWrite symbols for JIT code for Linux perf\n"
+          "     --profile=FILE\tProfile processes; file name is optional\n"
+          "     --restore=FILE\tResume from checkpoint saved in FILE\n"
           "     --stats\t\tPrint statistics at end of run\n"
           "     --stop-delta=N\tStop after N delta cycles (default %d)\n"
           "     --stop-time=T\tStop after simulation time T (e.g. 5ns)\n"
+          "     --threads=N\tRun processes on N threads (0 for all CPUs)\n"
           "     --trace\t\tTrace simulation events\n"
+          "     --trace-file=FILE\tWrite binary event trace to FILE\n"
+          "     --trace-proc=GLOB\tOnly trace processes matching GLOB\n"
+          "     --trace-signal=G\tOnly trace signals matching glob G\n"
           " -w, --wave=FILE\tWrite waveform data; file name is optional\n"
           "\n"
           "Dump options:\n"
@@ -683,6 +883,9 @@ static void usage(void)
           " -b, --body\t\tDump package body\n"
           "     --nets\t\tShow mapping from signals to nets\n"
           "\n"
+          "Decode trace options:\n"
+          "     --csv\t\tPrint records as comma separated values\n"
+          "\n"
           "Make options:\n"
           "     --deps-only\tOutput dependencies without actions\n"
           "     --native\t\tGenerate actions for native code generation\n"
@@ -785,6 +988,7 @@ int main(int argc, char **argv)
       { "work",        required_argument, 0, 'w' },
       { "dump",        no_argument,       0, 'd' },
       { "codegen",     no_argument,       0, 'c' },
+      { "decode-trace", no_argument,      0, 'D' },
       { "make",        no_argument,       0, 'm' },
       { "std",         required_argument, 0, 's' },
       { "messages",    required_argument, 0, 'M' },
@@ -836,6 +1040,7 @@ int main(int argc, char **argv)
       case 'r':
       case 'c':
       case 'm':
+      case 'D':
          // Subcommand options are parsed later
          argc -= (optind - 1);
          argv += (optind - 1);
@@ -867,6 +1072,8 @@ int main(int argc, char **argv)
       return codegen(argc, argv);
    case 'm':
       return make_cmd(argc, argv);
+   case 'D':
+      return decode_trace_cmd(argc, argv);
    default:
       fatal("missing command, try %s --help for usage", PACKAGE);
       return EXIT_FAILURE;
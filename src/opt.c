@@ -18,8 +18,11 @@
 #include "util.h"
 #include "phase.h"
 #include "common.h"
+#include "hash.h"
+#include "rt/rt.h"
 
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -168,6 +171,307 @@ static void opt_tag_last_value_fcall(tree_t t)
    }
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// Tag processes that may run concurrently with other processes in the
+// same delta cycle.
+//
+// The runtime stages signal assignments, waits, and reports from these
+// processes and applies them in order afterwards. Any other access to
+// shared state rules a process out: references to variables declared
+// outside it, file operations, and calls to procedures, impure
+// functions, or foreign subprograms not declared within the process.
+//
+
+typedef struct {
+   hash_t *local;
+   bool    parallel;
+} opt_parallel_ctx_t;
+
+static void opt_parallel_local_fn(tree_t t, void *ctx)
+{
+   opt_parallel_ctx_t *pctx = ctx;
+
+   switch (tree_kind(t)) {
+   case T_VAR_DECL:
+   case T_FUNC_DECL:
+   case T_FUNC_BODY:
+   case T_PROC_DECL:
+   case T_PROC_BODY:
+      hash_put(pctx->local, t, t);
+      break;
+   default:
+      break;
+   }
+}
+
+static void opt_parallel_fn(tree_t t, void *ctx)
+{
+   opt_parallel_ctx_t *pctx = ctx;
+
+   switch (tree_kind(t)) {
+   case T_REF:
+      {
+         tree_t decl = tree_ref(t);
+         if ((tree_kind(decl) == T_VAR_DECL)
+             && (hash_get(pctx->local, decl) == NULL))
+            pctx->parallel = false;
+      }
+      break;
+
+   case T_FCALL:
+   case T_PCALL:
+      {
+         tree_t decl = tree_ref(t);
+         ident_t builtin = tree_attr_str(decl, builtin_i);
+         if (builtin != NULL) {
+            const char *name = istr(builtin);
+            if ((strncmp(name, "file_", 5) == 0)
+                || (strcmp(name, "endfile") == 0))
+               pctx->parallel = false;
+         }
+         else if (hash_get(pctx->local, decl) != NULL)
+            ;
+         else if ((tree_kind(t) == T_PCALL)
+                  || tree_attr_int(decl, impure_i, 0)
+                  || (tree_attr_tree(decl, foreign_i) != NULL))
+            pctx->parallel = false;
+      }
+      break;
+
+   default:
+      break;
+   }
+}
+
+static void opt_tag_parallel(tree_t top)
+{
+   const int nstmts = tree_stmts(top);
+   for (int i = 0; i < nstmts; i++) {
+      tree_t p = tree_stmt(top, i);
+      if (tree_kind(p) != T_PROCESS)
+         continue;
+
+      opt_parallel_ctx_t ctx = {
+         .local    = hash_new(64, true),
+         .parallel = true
+      };
+
+      tree_visit(p, opt_parallel_local_fn, &ctx);
+      tree_visit(p, opt_parallel_fn, &ctx);
+
+      if (ctx.parallel)
+         tree_add_attr_int(p, parallel_i, 1);
+
+      hash_free(ctx.local);
+   }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Tag processes that do nothing but toggle a BIT or BOOLEAN signal with
+// a fixed period
+//
+//   clk <= not clk after 5 ns;
+//
+//   process is
+//   begin
+//     clk <= not clk;
+//     wait for 5 ns;
+//   end process;
+//
+// The runtime schedules the next transaction for these itself rather
+// than running the generated code every half period.
+//
+
+static tree_t opt_clock_signal(tree_t assign)
+{
+   // Return the signal if this statement assigns its own inverse
+
+   if ((tree_kind(assign) != T_SIGNAL_ASSIGN)
+       || (tree_waveforms(assign) != 1))
+      return NULL;
+
+   int64_t reject;
+   if (tree_has_reject(assign) && !folded_int(tree_reject(assign), &reject))
+      return NULL;
+
+   tree_t target = tree_target(assign);
+   if (tree_kind(target) != T_REF)
+      return NULL;
+
+   tree_t decl = tree_ref(target);
+   if ((tree_kind(decl) != T_SIGNAL_DECL) || (tree_nets(decl) != 1))
+      return NULL;
+
+   ident_t type_i = type_ident(type_base_recur(tree_type(decl)));
+   if ((type_i != std_bit_i) && (type_i != std_bool_i))
+      return NULL;
+
+   tree_t value = tree_value(tree_waveform(assign, 0));
+   if ((tree_kind(value) != T_FCALL) || (tree_params(value) != 1))
+      return NULL;
+
+   ident_t builtin = tree_attr_str(tree_ref(value), builtin_i);
+   if ((builtin == NULL) || !icmp(builtin, "not"))
+      return NULL;
+
+   tree_t arg = tree_value(tree_param(value, 0));
+   if ((tree_kind(arg) != T_REF) || (tree_ref(arg) != decl))
+      return NULL;
+
+   return decl;
+}
+
+static clock_kind_t opt_clock_kind(tree_t p)
+{
+   if ((tree_decls(p) != 0) || (tree_stmts(p) != 2))
+      return CLOCK_NONE;
+
+   tree_t assign = tree_stmt(p, 0);
+   tree_t wait   = tree_stmt(p, 1);
+
+   tree_t decl = opt_clock_signal(assign);
+   if ((decl == NULL) || (tree_kind(wait) != T_WAIT) || tree_has_value(wait))
+      return CLOCK_NONE;
+
+   tree_t w = tree_waveform(assign, 0);
+   int64_t delay;
+
+   if (tree_has_delay(w)) {
+      // Must wait for only the clock signal to change
+      if (!tree_attr_int(wait, static_i, 0) || (tree_triggers(wait) != 1))
+         return CLOCK_NONE;
+
+      tree_t trigger = tree_trigger(wait, 0);
+      if ((tree_kind(trigger) != T_REF) || (tree_ref(trigger) != decl))
+         return CLOCK_NONE;
+
+      if (folded_int(tree_delay(w), &delay) && (delay > 0))
+         return CLOCK_AFTER;
+   }
+   else if (tree_has_delay(wait) && (tree_triggers(wait) == 0)) {
+      if (folded_int(tree_delay(wait), &delay) && (delay > 0))
+         return CLOCK_WAIT;
+   }
+
+   return CLOCK_NONE;
+}
+
+static void opt_tag_clocks(tree_t top)
+{
+   const int nstmts = tree_stmts(top);
+   for (int i = 0; i < nstmts; i++) {
+      tree_t p = tree_stmt(top, i);
+      if (tree_kind(p) != T_PROCESS)
+         continue;
+
+      const clock_kind_t kind = opt_clock_kind(p);
+      if (kind != CLOCK_NONE)
+         tree_add_attr_int(p, clock_i, kind);
+   }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Tag combinational processes: those with a sensitivity list and no
+// other wait statements that assign signals with zero delay and never
+// look at signal attributes such as 'EVENT.
+//
+// With --levelise the runtime runs chains of these processes in order
+// within a single delta cycle.
+//
+
+static void opt_comb_fn(tree_t t, void *ctx)
+{
+   bool *comb = ctx;
+
+   switch (tree_kind(t)) {
+   case T_WAIT:
+      if (!tree_attr_int(t, static_i, 0))
+         *comb = false;
+      break;
+
+   case T_SIGNAL_ASSIGN:
+      {
+         int64_t delay;
+         if (tree_has_reject(t)
+             && !(folded_int(tree_reject(t), &delay) && (delay == 0)))
+            *comb = false;
+
+         const int nwaves = tree_waveforms(t);
+         for (int i = 0; i < nwaves; i++) {
+            tree_t w = tree_waveform(t, i);
+            if (tree_has_delay(w)
+                && !(folded_int(tree_delay(w), &delay) && (delay == 0)))
+               *comb = false;
+         }
+      }
+      break;
+
+   case T_ATTR_REF:
+      switch (tree_attr_int(t, builtin_i, -1)) {
+      case ATTR_EVENT:
+      case ATTR_ACTIVE:
+      case ATTR_LAST_EVENT:
+      case ATTR_LAST_ACTIVE:
+      case ATTR_LAST_VALUE:
+      case ATTR_DRIVING:
+      case ATTR_DRIVING_VALUE:
+      case ATTR_DELAYED:
+      case ATTR_STABLE:
+      case ATTR_QUIET:
+      case ATTR_TRANSACTION:
+         *comb = false;
+         break;
+      default:
+         break;
+      }
+      break;
+
+   case T_FCALL:
+      {
+         // Functions such as RISING_EDGE take a signal parameter
+         tree_t decl = tree_ref(t);
+         if (tree_attr_str(decl, builtin_i) != NULL)
+            break;
+
+         const int nports = tree_ports(decl);
+         for (int i = 0; i < nports; i++) {
+            if (tree_class(tree_port(decl, i)) == C_SIGNAL)
+               *comb = false;
+         }
+      }
+      break;
+
+   default:
+      break;
+   }
+}
+
+static void opt_tag_comb(tree_t top)
+{
+   const int nstmts = tree_stmts(top);
+   for (int i = 0; i < nstmts; i++) {
+      tree_t p = tree_stmt(top, i);
+      if ((tree_kind(p) != T_PROCESS) || (tree_decls(p) > 0)
+          || !tree_attr_int(p, parallel_i, 0)
+          || tree_attr_int(p, postponed_i, 0))
+         continue;
+
+      const int nsub = tree_stmts(p);
+      if (nsub == 0)
+         continue;
+
+      tree_t wait = tree_stmt(p, nsub - 1);
+      if ((tree_kind(wait) != T_WAIT) || !tree_attr_int(wait, static_i, 0))
+         continue;
+
+      bool comb = true;
+      tree_visit(p, opt_comb_fn, &comb);
+
+      if (comb)
+         tree_add_attr_int(p, comb_i, 1);
+   }
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
 static void opt_tag(tree_t t, void *ctx)
@@ -201,4 +505,10 @@ void opt(tree_t top)
       opt_delete_wait_only(top);
 
    tree_visit(top, opt_tag, NULL);
+
+   if (tree_kind(top) == T_ELAB) {
+      opt_tag_parallel(top);
+      opt_tag_clocks(top);
+      opt_tag_comb(top);
+   }
 }
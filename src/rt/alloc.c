@@ -19,26 +19,90 @@
 
 #include <assert.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
 
 // Profiling shows a large proportion of simulation time is spent in
 // malloc and free. These routines provide a stack-based fixed-size
 // allocator that is faster and has better cache locality.
 
-#define INIT_ITEMS 128
+#define INIT_ITEMS     128
+#define HUGE_PAGE_SIZE (2 * 1024 * 1024)
 
 struct rt_chunk {
    void       *ptr;
+   size_t      nitems;
+   size_t      bytes;
+   bool        mapped;
    rt_chunk_t *next;
 };
 
+// Driver values are allocated from stacks shared by all groups whose
+// values round up to the same size class. Larger values use malloc.
+static const size_t slab_sizes[] = {
+   8, 16, 24, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768,
+   1024, 1536, 2048, 3072, 4096
+};
+
+#define N_SLAB_CLASSES ARRAY_LEN(slab_sizes)
+
+static rt_alloc_stack_t slab_classes[N_SLAB_CLASSES];
+static bool             huge_pages = false;
+
+static void *rt_alloc_chunk_mem(rt_chunk_t *c)
+{
+   if (huge_pages) {
+      // Round up to whole huge pages and ask for transparent huge page
+      // backing which the kernel may or may not provide
+      c->bytes  = (c->bytes + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+      c->mapped = true;
+
+      void *ptr = mmap(NULL, c->bytes, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (ptr == MAP_FAILED)
+         fatal_errno("mmap");
+
+#ifdef MADV_HUGEPAGE
+      (void)madvise(ptr, c->bytes, MADV_HUGEPAGE);
+#endif
+      return ptr;
+   }
+   else {
+      c->mapped = false;
+      return xmalloc(c->bytes);
+   }
+}
+
+static void rt_free_chunk(rt_chunk_t *c)
+{
+   if (c->mapped) {
+      if (munmap(c->ptr, c->bytes) != 0)
+         fatal_errno("munmap");
+   }
+   else
+      free(c->ptr);
+
+   free(c);
+}
+
 static void rt_alloc_add_objects(rt_alloc_stack_t s, size_t n)
 {
    rt_chunk_t *c = xmalloc(sizeof(rt_chunk_t));
-   c->next = s->chunks;
-   c->ptr  = xmalloc(n * s->item_sz);
+   c->next   = s->chunks;
+   c->bytes  = n * s->item_sz;
+   c->ptr    = rt_alloc_chunk_mem(c);
+   c->nitems = c->bytes / s->item_sz;
+
+   if (s->stack_sz + c->nitems > s->stack_alloc) {
+      s->stack_alloc = MAX(s->stack_alloc * 2, s->stack_sz + c->nitems);
+      s->stack = xrealloc(s->stack, sizeof(void *) * s->stack_alloc);
+   }
+
+   s->stack_sz  += c->nitems;
+   s->stack_low += c->nitems;
 
    char *p = c->ptr;
-   for (int i = 0; i < n; i++, p += s->item_sz)
+   for (int i = 0; i < c->nitems; i++, p += s->item_sz)
       rt_free(s, p);
 
    s->chunks = c;
@@ -47,28 +111,27 @@ static void rt_alloc_add_objects(rt_alloc_stack_t s, size_t n)
 rt_alloc_stack_t rt_alloc_stack_new(size_t size, const char *name)
 {
    struct rt_alloc_stack *s = xmalloc(sizeof(struct rt_alloc_stack));
-   s->stack     = xmalloc(sizeof(void *) * INIT_ITEMS);
-   s->stack_sz  = INIT_ITEMS;
-   s->stack_top = 0;
-   s->item_sz   = size;
-   s->name      = name;
-   s->chunks    = NULL;
+   s->stack       = NULL;
+   s->stack_sz    = 0;
+   s->stack_top   = 0;
+   s->stack_low   = 0;
+   s->stack_alloc = 0;
+   s->item_sz     = size;
+   s->peak        = 0;
+   s->trimmed     = 0;
+   s->name        = name;
+   s->chunks      = NULL;
 
    rt_alloc_add_objects(s, INIT_ITEMS);
 
    return s;
 }
 
-void rt_alloc_stack_destroy(rt_alloc_stack_t s)
+static void rt_alloc_stack_free(rt_alloc_stack_t s)
 {
-   if (s->stack_top != s->stack_sz)
-      fatal("memory leak of %zu items from %s stack",
-            s->stack_sz - s->stack_top, s->name);
-
    while (s->chunks != NULL) {
       rt_chunk_t *tmp = s->chunks->next;
-      free(s->chunks->ptr);
-      free(s->chunks);
+      rt_free_chunk(s->chunks);
       s->chunks = tmp;
    }
 
@@ -76,14 +139,148 @@ void rt_alloc_stack_destroy(rt_alloc_stack_t s)
    free(s);
 }
 
+void rt_alloc_stack_destroy(rt_alloc_stack_t s)
+{
+   if (s->stack_top != s->stack_sz)
+      fatal("memory leak of %zu items from %s stack",
+            s->stack_sz - s->stack_top, s->name);
+
+   rt_alloc_stack_free(s);
+}
+
 void *rt_alloc_slow(rt_alloc_stack_t s)
 {
-   if (s->stack_top == 0) {
-      s->stack_sz *= 2;
-      s->stack = xrealloc(s->stack, sizeof(void *) * s->stack_sz);
+   if (s->stack_top == 0)
+      rt_alloc_add_objects(s, MAX(s->stack_sz, INIT_ITEMS));
+
+   void *ptr = s->stack[--s->stack_top];
+   s->stack_low = MIN(s->stack_low, s->stack_top);
+   return ptr;
+}
+
+static int rt_alloc_ptr_cmp(const void *a, const void *b)
+{
+   const uintptr_t pa = (uintptr_t)*(void * const *)a;
+   const uintptr_t pb = (uintptr_t)*(void * const *)b;
 
-      rt_alloc_add_objects(s, s->stack_sz / 2);
+   return (pa > pb) - (pa < pb);
+}
+
+size_t rt_alloc_stack_hwm(rt_alloc_stack_t s)
+{
+   // The most items that have been in use at once
+
+   return MAX(s->peak, s->stack_sz - s->stack_low);
+}
+
+size_t rt_alloc_stack_trim(rt_alloc_stack_t s)
+{
+   // Release chunks that are entirely free, but no more items than have
+   // stayed free since the last call as anything above that high water
+   // mark of use is likely to be needed again soon
+
+   const size_t spare = s->stack_low;
+   s->peak = MAX(s->peak, s->stack_sz - s->stack_low);
+   s->stack_low = s->stack_top;
+
+   // Sorting the free stack is only worth it when at least half the
+   // items have gone unused
+   if ((spare * 2 <= s->stack_sz) || (s->chunks == NULL))
+      return 0;
+
+   qsort(s->stack, s->stack_top, sizeof(void *), rt_alloc_ptr_cmp);
+
+   size_t released = 0;
+   rt_chunk_t **pc = &(s->chunks);
+   while (*pc != NULL) {
+      rt_chunk_t *c = *pc;
+      if (released + c->nitems > spare) {
+         pc = &(c->next);
+         continue;
+      }
+
+      // Find the first free item at or above the start of the chunk
+      const char *start = c->ptr;
+      size_t lo = 0, hi = s->stack_top;
+      while (lo < hi) {
+         const size_t mid = (lo + hi) / 2;
+         if ((const char *)s->stack[mid] < start)
+            lo = mid + 1;
+         else
+            hi = mid;
+      }
+
+      // Free items are unique so the chunk is entirely free if the next
+      // nitems entries all lie within it
+      const size_t end = lo + c->nitems;
+      if ((end <= s->stack_top)
+          && ((const char *)s->stack[end - 1] < start + c->bytes)) {
+         memmove(s->stack + lo, s->stack + end,
+                 (s->stack_top - end) * sizeof(void *));
+         s->stack_top -= c->nitems;
+         s->stack_sz  -= c->nitems;
+         released     += c->nitems;
+
+         *pc = c->next;
+         rt_free_chunk(c);
+      }
+      else
+         pc = &(c->next);
+   }
+
+   s->stack_low = s->stack_top;
+   s->trimmed  += released;
+   return released;
+}
+
+void rt_alloc_huge_pages(bool enable)
+{
+   huge_pages = enable;
+}
+
+rt_alloc_stack_t rt_slab_class(size_t size)
+{
+   for (int i = 0; i < N_SLAB_CLASSES; i++) {
+      if (size <= slab_sizes[i]) {
+         if (slab_classes[i] == NULL)
+            slab_classes[i] = rt_alloc_stack_new(slab_sizes[i], "value");
+         return slab_classes[i];
+      }
+   }
+
+   return NULL;
+}
+
+void rt_slab_trim(void)
+{
+   for (int i = 0; i < N_SLAB_CLASSES; i++) {
+      if (slab_classes[i] != NULL)
+         rt_alloc_stack_trim(slab_classes[i]);
    }
+}
+
+void rt_slab_stats(void)
+{
+   for (int i = 0; i < N_SLAB_CLASSES; i++) {
+      rt_alloc_stack_t s = slab_classes[i];
+      if (s == NULL)
+         continue;
 
-   return s->stack[--s->stack_top];
+      notef("value slab %4zu bytes: used:%zu peak:%zu capacity:%zu "
+            "trimmed:%zu", s->item_sz, s->stack_sz - s->stack_top,
+            rt_alloc_stack_hwm(s), s->stack_sz, s->trimmed);
+   }
+}
+
+void rt_slab_destroy(void)
+{
+   // Values still attached to waveforms when a run is abandoned are
+   // not returned to the slab so do not check for leaks here
+
+   for (int i = 0; i < N_SLAB_CLASSES; i++) {
+      if (slab_classes[i] != NULL) {
+         rt_alloc_stack_free(slab_classes[i]);
+         slab_classes[i] = NULL;
+      }
+   }
 }
@@ -21,6 +21,7 @@
 #include "util.h"
 
 #include <assert.h>
+#include <stdbool.h>
 
 typedef struct rt_chunk rt_chunk_t;
 
@@ -28,7 +29,11 @@ struct rt_alloc_stack {
    void      **stack;
    size_t      stack_sz;
    size_t      stack_top;
+   size_t      stack_low;
+   size_t      stack_alloc;
    size_t      item_sz;
+   size_t      peak;
+   size_t      trimmed;
    const char *name;
    rt_chunk_t *chunks;
 };
@@ -38,13 +43,24 @@ typedef struct rt_alloc_stack *rt_alloc_stack_t;
 rt_alloc_stack_t rt_alloc_stack_new(size_t size, const char *name);
 void rt_alloc_stack_destroy(rt_alloc_stack_t stack);
 void *rt_alloc_slow(rt_alloc_stack_t stack);
+size_t rt_alloc_stack_trim(rt_alloc_stack_t stack);
+size_t rt_alloc_stack_hwm(rt_alloc_stack_t stack);
+void rt_alloc_huge_pages(bool enable);
+
+rt_alloc_stack_t rt_slab_class(size_t size);
+void rt_slab_trim(void);
+void rt_slab_stats(void);
+void rt_slab_destroy(void);
 
 static inline void *rt_alloc(rt_alloc_stack_t s)
 {
    if (unlikely(s->stack_top == 0))
       return rt_alloc_slow(s);
-   else
-      return s->stack[--s->stack_top];
+
+   void *ptr = s->stack[--s->stack_top];
+   if (s->stack_top < s->stack_low)
+      s->stack_low = s->stack_top;
+   return ptr;
 }
 
 static inline void rt_free(rt_alloc_stack_t s, void *ptr)
@@ -18,6 +18,7 @@
 #include "util.h"
 #include "heap.h"
 
+#include <assert.h>
 #include <inttypes.h>
 #include <stdlib.h>
 
@@ -25,49 +26,71 @@
 #define LEFT(i)   (i << 1)
 #define RIGHT(i)  ((i << 1) + 1)
 
+// Each element is given a handle when it is inserted which remains
+// valid until it is extracted or deleted. The where array maps handles
+// to the current position of the element in the heap.
+
 struct node {
    void     *user;
-   uint64_t key;
+   uint64_t  key;
+   uint32_t  handle;
 };
 
 struct heap {
    struct node *nodes;
-   size_t    size;
-   size_t    max_size;
+   size_t       size;
+   size_t       max_size;
+   uint32_t    *where;
+   uint32_t    *free_handles;
+   size_t       n_free;
 };
 
 #define NODE(h, i) (h->nodes[i - 1])
 #define KEY(h, i)  (NODE(h, i).key)
 #define USER(h, i) (NODE(h, i).user)
 
-static inline void exchange(heap_t h, size_t i, size_t j)
+static inline void heap_move(heap_t h, size_t to, size_t from)
+{
+   NODE(h, to) = NODE(h, from);
+   h->where[NODE(h, to).handle] = to;
+}
+
+static inline void heap_place(heap_t h, size_t i, const struct node *n)
 {
-   struct node tmp = NODE(h, j);
-   NODE(h, j) = NODE(h, i);
-   NODE(h, i) = tmp;
+   NODE(h, i) = *n;
+   h->where[n->handle] = i;
 }
 
 static void min_heapify(heap_t h, size_t i)
 {
+   // Sift the node at i downwards moving a hole rather than swapping so
+   // each step only updates one position in the where array
+
+   const struct node n = NODE(h, i);
+
    for (;;) {
       const size_t l = LEFT(i);
       const size_t r = RIGHT(i);
 
-      size_t smallest;
-      if (l <= h->size && KEY(h, l) < KEY(h, i))
+      size_t smallest = i;
+      uint64_t smallest_key = n.key;
+
+      if (l <= h->size && KEY(h, l) < smallest_key) {
          smallest = l;
-      else
-         smallest = i;
+         smallest_key = KEY(h, l);
+      }
 
-      if (r <= h->size && KEY(h, r) < KEY(h, smallest))
+      if (r <= h->size && KEY(h, r) < smallest_key)
          smallest = r;
 
       if (smallest == i)
          break;
 
-      exchange(h, i, smallest);
+      heap_move(h, i, smallest);
       i = smallest;
    }
+
+   heap_place(h, i, &n);
 }
 
 static inline void heap_decrease_key(heap_t h, size_t i, uint64_t key)
@@ -76,24 +99,43 @@ static inline void heap_decrease_key(heap_t h, size_t i, uint64_t key)
       fatal("new key is larger than current key");
 
    KEY(h, i) = key;
-   while (i > 1 && KEY(h, PARENT(i)) > KEY(h, i)) {
-      exchange(h, i, PARENT(i));
+
+   const struct node n = NODE(h, i);
+
+   while (i > 1 && KEY(h, PARENT(i)) > key) {
+      heap_move(h, i, PARENT(i));
       i = PARENT(i);
    }
+
+   heap_place(h, i, &n);
+}
+
+static void heap_add_handles(heap_t h, size_t first, size_t last)
+{
+   for (size_t i = last; i > first; i--)
+      h->free_handles[(h->n_free)++] = i - 1;
 }
 
 heap_t heap_new(size_t init_size)
 {
    struct heap *h = xmalloc(sizeof(struct heap));
-   h->nodes    = xmalloc(init_size * sizeof(struct node));
-   h->max_size = init_size;
-   h->size     = 0;
+   h->nodes        = xmalloc(init_size * sizeof(struct node));
+   h->where        = xmalloc(init_size * sizeof(uint32_t));
+   h->free_handles = xmalloc(init_size * sizeof(uint32_t));
+   h->max_size     = init_size;
+   h->size         = 0;
+   h->n_free       = 0;
+
+   heap_add_handles(h, 0, init_size);
+
    return h;
 }
 
 void heap_free(heap_t h)
 {
    free(h->nodes);
+   free(h->where);
+   free(h->free_handles);
    free(h);
 }
 
@@ -103,12 +145,33 @@ void *heap_extract_min(heap_t h)
       fatal_trace("heap underflow");
 
    void *min = USER(h, 1);
-   NODE(h, 1) = NODE(h, h->size);
+   h->free_handles[(h->n_free)++] = NODE(h, 1).handle;
+   heap_move(h, 1, h->size);
    --(h->size);
    min_heapify(h, 1);
    return min;
 }
 
+void heap_delete(heap_t h, uint32_t handle)
+{
+   const size_t i = h->where[handle];
+   assert(i >= 1 && i <= h->size);
+   assert(NODE(h, i).handle == handle);
+
+   h->free_handles[(h->n_free)++] = handle;
+
+   const uint64_t key = KEY(h, i);
+   heap_move(h, i, h->size);
+   --(h->size);
+
+   if (i <= h->size) {
+      if (KEY(h, i) < key)
+         heap_decrease_key(h, i, KEY(h, i));
+      else
+         min_heapify(h, i);
+   }
+}
+
 void *heap_min(heap_t h)
 {
    if (unlikely(h->size < 1))
@@ -117,19 +180,30 @@ void *heap_min(heap_t h)
    return USER(h, 1);
 }
 
-void heap_insert(heap_t h, uint64_t key, void *user)
+uint32_t heap_insert(heap_t h, uint64_t key, void *user)
 {
    if (unlikely(h->size == h->max_size)) {
+      const size_t old_size = h->max_size;
       h->max_size *= 2;
       h->nodes = xrealloc(h->nodes, h->max_size * sizeof(struct node));
+      h->where = xrealloc(h->where, h->max_size * sizeof(uint32_t));
+      h->free_handles = xrealloc(h->free_handles,
+                                 h->max_size * sizeof(uint32_t));
+      heap_add_handles(h, old_size, h->max_size);
    }
 
    ++(h->size);
 
-   KEY(h, h->size) = UINT64_MAX;
+   const uint32_t handle = h->free_handles[--(h->n_free)];
+
+   KEY(h, h->size)  = UINT64_MAX;
    USER(h, h->size) = user;
+   NODE(h, h->size).handle = handle;
+   h->where[handle] = h->size;
 
    heap_decrease_key(h, h->size, key);
+
+   return handle;
 }
 
 size_t heap_size(heap_t h)
@@ -29,7 +29,8 @@ heap_t heap_new(size_t init_size);
 void heap_free(heap_t h);
 void *heap_extract_min(heap_t h);
 void *heap_min(heap_t h);
-void heap_insert(heap_t h, uint64_t key, void *user);
+uint32_t heap_insert(heap_t h, uint64_t key, void *user);
+void heap_delete(heap_t h, uint32_t handle);
 size_t heap_size(heap_t h);
 void heap_walk(heap_t h, heap_walk_fn_t fn, void *context);
 
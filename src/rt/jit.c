@@ -28,6 +28,8 @@
 #include <dlfcn.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
 
 #include <llvm-c/Core.h>
 #include <llvm-c/BitReader.h>
@@ -39,6 +41,11 @@ static LLVMExecutionEngineRef exec_engine = NULL;
 static bool using_jit = true;
 static void *dl_handle = NULL;
 
+typedef struct {
+   uintptr_t   addr;
+   const char *name;
+} perf_sym_t;
+
 #ifdef LLVM_MANGLES_NAMES
 static char *jit_str_add(char *p, const char *s)
 {
@@ -164,6 +171,74 @@ void jit_bind_fn(const char *name, void *ptr)
    }
 }
 
+static int jit_perf_sym_cmp(const void *a, const void *b)
+{
+   const uintptr_t aa = ((const perf_sym_t *)a)->addr;
+   const uintptr_t ab = ((const perf_sym_t *)b)->addr;
+
+   return (aa > ab) - (aa < ab);
+}
+
+void jit_write_perf_map(void)
+{
+   // Linux perf looks up symbols for anonymous executable mappings in
+   // /tmp/perf-<pid>.map. Code loaded from a shared library already has
+   // an ELF symbol table so this is only needed for the JIT. The LLVM C
+   // API does not give the size of generated functions so each is
+   // assumed to extend to the start of the next, and the last to the
+   // end of its page.
+
+   if (!using_jit)
+      return;
+
+   size_t nsyms = 0, max_syms = 256;
+   perf_sym_t *syms = xmalloc(max_syms * sizeof(perf_sym_t));
+
+   LLVMValueRef fn = LLVMGetFirstFunction(module);
+   for (; fn != NULL; fn = LLVMGetNextFunction(fn)) {
+      if (LLVMIsDeclaration(fn))
+         continue;
+
+      void *ptr = LLVMGetPointerToGlobal(exec_engine, fn);
+      if (ptr == NULL)
+         continue;
+
+      if (nsyms == max_syms) {
+         max_syms *= 2;
+         syms = xrealloc(syms, max_syms * sizeof(perf_sym_t));
+      }
+
+      syms[nsyms].addr = (uintptr_t)ptr;
+      syms[nsyms].name = LLVMGetValueName(fn);
+      nsyms++;
+   }
+
+   qsort(syms, nsyms, sizeof(perf_sym_t), jit_perf_sym_cmp);
+
+   char path[PATH_MAX];
+   checked_sprintf(path, sizeof(path), "/tmp/perf-%d.map", getpid());
+
+   FILE *f = fopen(path, "w");
+   if (f == NULL)
+      fatal_errno("failed to open %s", path);
+
+   const uintptr_t page_sz = sysconf(_SC_PAGESIZE);
+
+   for (size_t i = 0; i < nsyms; i++) {
+      uintptr_t end;
+      if ((i + 1 < nsyms) && (syms[i + 1].addr > syms[i].addr))
+         end = syms[i + 1].addr;
+      else
+         end = (syms[i].addr + page_sz) & ~(page_sz - 1);
+
+      fprintf(f, "%"PRIxPTR" %"PRIxPTR" %s\n", syms[i].addr,
+              end - syms[i].addr, syms[i].name);
+   }
+
+   fclose(f);
+   free(syms);
+}
+
 static void jit_init_llvm(const char *path)
 {
    char *error;
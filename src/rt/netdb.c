@@ -17,69 +17,81 @@
 
 #include "netdb.h"
 #include "util.h"
+#include "lib.h"
 
 #include <stdlib.h>
 #include <assert.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 netdb_t *netdb_open(tree_t top)
 {
    char *name = xasprintf("_%s.netdb", istr(tree_ident(top)));
-   fbuf_t *f = lib_fbuf_open(lib_work(), name, FBUF_IN);
-   if (f == NULL)
+
+   char path[PATH_MAX];
+   lib_realpath(lib_work(), name, path, sizeof(path));
+
+   int fd = open(path, O_RDONLY);
+   if (fd < 0)
       fatal("failed to open net database file %s", name);
+
+   struct stat buf;
+   if (fstat(fd, &buf) != 0)
+      fatal_errno("fstat");
+
+   if (buf.st_size < sizeof(netdb_header_t))
+      fatal("net database file %s is truncated", name);
+
+   void *mapping = mmap(NULL, buf.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+   if (mapping == MAP_FAILED)
+      fatal_errno("mmap");
+
+   close(fd);
+
+   const netdb_header_t *header = mapping;
+   if (header->magic != NETDB_MAGIC)
+      fatal("net database file %s has an unknown format: elaborate "
+            "the design again", name);
+
+   const size_t expect = sizeof(netdb_header_t)
+      + sizeof(uint32_t) * (2 * (size_t)header->ngroups + header->nnets);
+   if (buf.st_size != expect)
+      fatal("net database file %s is truncated", name);
+
    free(name);
 
+   const uint32_t *arrays = (const uint32_t *)(header + 1);
+
    netdb_t *db = xmalloc(sizeof(struct netdb));
-   db->groups = NULL;
-   db->max    = 0;
-   db->nnets  = 0;
-
-   groupid_t gid;
-   while ((gid = read_u32(f)) != GROUPID_INVALID) {
-      group_t *g = xmalloc(sizeof(struct group));
-      g->next   = db->groups;
-      g->gid    = gid;
-      g->first  = read_u32(f);
-      g->length = read_u32(f);
-
-      db->groups = g;
-      db->max    = MAX(db->max, gid);
-      db->nnets  = MAX(db->nnets, g->first + g->length);
-   }
-
-   fbuf_close(f);
-
-   db->map = xmalloc(sizeof(groupid_t) * db->nnets);
-   for (netid_t i = 0; i < db->nnets; i++)
-      db->map[i] = GROUPID_INVALID;
-
-   for (group_t *it = db->groups; it != NULL; it = it->next) {
-      for (netid_t i = it->first; i < it->first + it->length; i++)
-         db->map[i] = it->gid;
-   }
+   db->mapping = mapping;
+   db->maplen  = buf.st_size;
+   db->ngroups = header->ngroups;
+   db->nnets   = header->nnets;
+   db->first   = arrays;
+   db->length  = arrays + header->ngroups;
+   db->map     = arrays + (2 * header->ngroups);
 
    return db;
 }
 
 void netdb_close(netdb_t *db)
 {
-   while (db->groups != NULL) {
-      group_t *next = db->groups->next;
-      free(db->groups);
-      db->groups = next;
-   }
+   if (munmap(db->mapping, db->maplen) != 0)
+      fatal_errno("munmap");
 
-   free(db->map);
    free(db);
 }
 
 unsigned netdb_size(netdb_t *db)
 {
-   return db->max + 1;
+   return db->ngroups;
 }
 
 void netdb_walk(netdb_t *db, netdb_walk_fn_t fn)
 {
-   for (group_t *it = db->groups; it != NULL; it = it->next)
-      (*fn)(it->gid, it->first, it->length);
+   for (groupid_t gid = 0; gid < db->ngroups; gid++)
+      (*fn)(gid, db->first[gid], db->length[gid]);
 }
@@ -20,6 +20,7 @@
 
 #include "tree.h"
 
+#include <stddef.h>
 #include <stdint.h>
 #include <assert.h>
 
@@ -27,24 +28,31 @@ typedef uint32_t groupid_t;
 
 #define GROUPID_INVALID UINT32_MAX
 #define NETDB_DEBUG     0
+#define NETDB_MAGIC     0x3142444e   // "NDB1"
 
 typedef struct netdb netdb_t;
-typedef struct group group_t;
 
 typedef void (*netdb_walk_fn_t)(groupid_t, netid_t, unsigned);
 
-struct group {
-   group_t  *next;
-   groupid_t gid;
-   netid_t   first;
-   unsigned  length;
-};
+// The net database file is this header followed by the first net and
+// length of each group indexed by group ID and then the group ID of
+// each net. Groups are numbered in net order. All fields are uint32_t
+// in native byte order so the file can be mapped and used directly.
+typedef struct {
+   uint32_t magic;
+   uint32_t ngroups;
+   uint32_t nnets;
+   uint32_t reserved;
+} netdb_header_t;
 
 struct netdb {
-   group_t   *groups;
-   groupid_t *map;
-   netid_t    nnets;
-   unsigned   max;
+   void            *mapping;
+   size_t           maplen;
+   const netid_t   *first;
+   const uint32_t  *length;
+   const groupid_t *map;
+   netid_t          nnets;
+   unsigned         ngroups;
 };
 
 netdb_t *netdb_open(tree_t top);
@@ -0,0 +1,252 @@
+//
+//  Copyright (C) 2015  Nick Gasson
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "profile.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#define REPORT_PROCS  20
+#define REPORT_GROUPS 10
+
+typedef struct {
+   unsigned index;
+   uint64_t count;
+} prof_rank_t;
+
+static const char *wake_names[PROF_NWAKE] = {
+   "static", "dynamic", "timeout"
+};
+
+static uint64_t profile_ns(void)
+{
+   struct timespec ts;
+   if (clock_gettime(CLOCK_MONOTONIC, &ts) != 0)
+      fatal_errno("clock_gettime");
+   return (uint64_t)ts.tv_sec * UINT64_C(1000000000) + ts.tv_nsec;
+}
+
+static int profile_rank_cmp(const void *a, const void *b)
+{
+   const prof_rank_t *ra = a;
+   const prof_rank_t *rb = b;
+
+   if (ra->count > rb->count)
+      return -1;
+   else if (ra->count < rb->count)
+      return 1;
+   else
+      return (int)ra->index - (int)rb->index;
+}
+
+static prof_rank_t *profile_rank(const uint64_t *counts, size_t stride,
+                                 unsigned n, unsigned *nranked)
+{
+   // Sort the non-zero counts in descending order
+
+   prof_rank_t *ranks = xmalloc(sizeof(prof_rank_t) * MAX(n, 1));
+
+   unsigned count = 0;
+   for (unsigned i = 0; i < n; i++) {
+      const char *ptr = (const char *)counts + i * stride;
+      const uint64_t c = *(const uint64_t *)ptr;
+      if (c > 0) {
+         ranks[count].index = i;
+         ranks[count].count = c;
+         count++;
+      }
+   }
+
+   qsort(ranks, count, sizeof(prof_rank_t), profile_rank_cmp);
+
+   *nranked = count;
+   return ranks;
+}
+
+static void profile_json_str(FILE *f, const char *str)
+{
+   fputc('"', f);
+   for (const char *p = str; *p != '\0'; p++) {
+      if ((*p == '"') || (*p == '\\'))
+         fprintf(f, "\\%c", *p);
+      else if ((unsigned char)*p < 0x20)
+         fprintf(f, "\\u%04x", *p);
+      else
+         fputc(*p, f);
+   }
+   fputc('"', f);
+}
+
+profile_t *profile_new(unsigned nprocs, unsigned ngroups)
+{
+   profile_t *p = xmalloc(sizeof(profile_t));
+   memset(p, '\0', sizeof(profile_t));
+
+   p->nprocs       = nprocs;
+   p->ngroups      = ngroups;
+   p->procs        = xmalloc(sizeof(prof_proc_t) * MAX(nprocs, 1));
+   p->sources      = xmalloc(sizeof(tree_t) * MAX(nprocs, 1));
+   p->group_events = xmalloc(sizeof(uint64_t) * MAX(ngroups, 1));
+
+   memset(p->procs, '\0', sizeof(prof_proc_t) * nprocs);
+   memset(p->sources, '\0', sizeof(tree_t) * nprocs);
+   memset(p->group_events, '\0', sizeof(uint64_t) * ngroups);
+
+   p->start_ns    = profile_ns();
+   p->start_ticks = profile_ticks();
+
+   return p;
+}
+
+void profile_free(profile_t *p)
+{
+   free(p->procs);
+   free(p->sources);
+   free(p->group_events);
+   free(p);
+}
+
+void profile_set_source(profile_t *p, unsigned proc, tree_t source)
+{
+   assert(proc < p->nprocs);
+   p->sources[proc] = source;
+}
+
+void profile_time_step(profile_t *p, unsigned deltas)
+{
+   p->steps++;
+   p->deltas += deltas;
+   p->max_deltas = MAX(p->max_deltas, deltas);
+
+   int bucket = 0;
+   while ((deltas >>= 1) > 0)
+      bucket++;
+
+   p->delta_hist[MIN(bucket, PROF_DELTA_BUCKETS - 1)]++;
+}
+
+static void profile_write_json(profile_t *p, const char *fname,
+                               prof_name_fn_t group_name, double ns_per_tick,
+                               const prof_rank_t *procs, unsigned nprocs,
+                               const prof_rank_t *groups, unsigned ngroups)
+{
+   FILE *f = fopen(fname, "w");
+   if (f == NULL)
+      fatal_errno("failed to open %s", fname);
+
+   fprintf(f, "{\n  \"ns_per_tick\": %.6f,\n", ns_per_tick);
+   fprintf(f, "  \"time_steps\": %"PRIu64",\n", p->steps);
+   fprintf(f, "  \"delta_cycles\": %"PRIu64",\n", p->deltas);
+   fprintf(f, "  \"max_deltas_per_step\": %"PRIu64",\n", p->max_deltas);
+
+   // Bucket i counts time steps with between 2^i and 2^(i+1)-1 cycles
+   fprintf(f, "  \"deltas_per_step\": [");
+   for (int i = 0; i < PROF_DELTA_BUCKETS; i++)
+      fprintf(f, "%s%"PRIu64, (i > 0) ? ", " : "", p->delta_hist[i]);
+   fprintf(f, "],\n");
+
+   fprintf(f, "  \"processes\": [");
+   for (unsigned i = 0; i < nprocs; i++) {
+      const prof_proc_t *pp = &(p->procs[procs[i].index]);
+      tree_t source = p->sources[procs[i].index];
+      const loc_t *loc = tree_loc(source);
+
+      fprintf(f, "%s\n    { \"name\": ", (i > 0) ? "," : "");
+      profile_json_str(f, istr(tree_ident(source)));
+      fprintf(f, ", \"file\": ");
+      profile_json_str(f, (loc->file != NULL) ? loc->file : "");
+      fprintf(f, ", \"line\": %u, \"runs\": %"PRIu64", \"ticks\": %"PRIu64
+              ", \"ns\": %.0f, \"wakeups\": {", loc->first_line, pp->runs,
+              pp->ticks, pp->ticks * ns_per_tick);
+      for (int j = 0; j < PROF_NWAKE; j++)
+         fprintf(f, "%s\"%s\": %"PRIu64, (j > 0) ? ", " : " ",
+                 wake_names[j], pp->wakeups[j]);
+      fprintf(f, " } }");
+   }
+   fprintf(f, "\n  ],\n");
+
+   fprintf(f, "  \"groups\": [");
+   for (unsigned i = 0; i < ngroups; i++) {
+      fprintf(f, "%s\n    { \"name\": ", (i > 0) ? "," : "");
+      profile_json_str(f, (*group_name)(groups[i].index));
+      fprintf(f, ", \"events\": %"PRIu64" }", groups[i].count);
+   }
+   fprintf(f, "\n  ]\n}\n");
+
+   fclose(f);
+}
+
+void profile_report(profile_t *p, const char *json, prof_name_fn_t group_name)
+{
+   const uint64_t elapsed_ns    = profile_ns() - p->start_ns;
+   const uint64_t elapsed_ticks = profile_ticks() - p->start_ticks;
+   const double ns_per_tick =
+      (elapsed_ticks > 0) ? (double)elapsed_ns / elapsed_ticks : 1.0;
+
+   uint64_t total_ticks = 0;
+   for (unsigned i = 0; i < p->nprocs; i++)
+      total_ticks += p->procs[i].ticks;
+
+   unsigned nprocs, ngroups;
+   prof_rank_t *procs = profile_rank(&(p->procs[0].ticks),
+                                     sizeof(prof_proc_t), p->nprocs, &nprocs);
+   prof_rank_t *groups = profile_rank(p->group_events, sizeof(uint64_t),
+                                      p->ngroups, &ngroups);
+
+   fprintf(stderr, "Profile: %"PRIu64" time steps, %"PRIu64" delta cycles "
+           "(mean %.2f, max %"PRIu64" per step), %.1fms in processes of "
+           "%.1fms\n", p->steps, p->deltas,
+           (p->steps > 0) ? (double)p->deltas / p->steps : 0.0,
+           p->max_deltas, total_ticks * ns_per_tick / 1e6,
+           elapsed_ns / 1e6);
+
+   fprintf(stderr, "%6s %10s %10s %10s %10s %10s  %s\n", "%time", "runs",
+           "ns/run", "static", "dynamic", "timeout", "process");
+
+   for (unsigned i = 0; i < MIN(nprocs, REPORT_PROCS); i++) {
+      const prof_proc_t *pp = &(p->procs[procs[i].index]);
+      tree_t source = p->sources[procs[i].index];
+      const loc_t *loc = tree_loc(source);
+
+      fprintf(stderr, "%6.2f %10"PRIu64" %10.0f %10"PRIu64" %10"PRIu64
+              " %10"PRIu64"  %s (%s:%u)\n",
+              100.0 * pp->ticks / MAX(total_ticks, 1), pp->runs,
+              pp->ticks * ns_per_tick / MAX(pp->runs, 1),
+              pp->wakeups[PROF_WAKE_STATIC], pp->wakeups[PROF_WAKE_DYNAMIC],
+              pp->wakeups[PROF_WAKE_TIMEOUT], istr(tree_ident(source)),
+              (loc->file != NULL) ? loc->file : "?", loc->first_line);
+   }
+
+   if (ngroups > 0) {
+      fprintf(stderr, "%10s  %s\n", "events", "signal");
+      for (unsigned i = 0; i < MIN(ngroups, REPORT_GROUPS); i++)
+         fprintf(stderr, "%10"PRIu64"  %s\n", groups[i].count,
+                 (*group_name)(groups[i].index));
+   }
+
+   if (json != NULL) {
+      profile_write_json(p, json, group_name, ns_per_tick,
+                         procs, nprocs, groups, ngroups);
+      notef("profile data written to %s", json);
+   }
+
+   free(procs);
+   free(groups);
+}
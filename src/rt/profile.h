@@ -0,0 +1,93 @@
+//
+//  Copyright (C) 2015  Nick Gasson
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef _PROFILE_H
+#define _PROFILE_H
+
+#include "util.h"
+#include "tree.h"
+
+#include <stdint.h>
+#include <time.h>
+
+#define PROF_DELTA_BUCKETS 16
+
+typedef enum {
+   PROF_WAKE_STATIC,
+   PROF_WAKE_DYNAMIC,
+   PROF_WAKE_TIMEOUT,
+
+   PROF_NWAKE
+} prof_wake_t;
+
+typedef struct {
+   uint64_t runs;
+   uint64_t ticks;
+   uint64_t wakeups[PROF_NWAKE];
+} prof_proc_t;
+
+typedef struct profile {
+   unsigned     nprocs;
+   unsigned     ngroups;
+   prof_proc_t *procs;
+   tree_t      *sources;
+   uint64_t    *group_events;
+   uint64_t     steps;
+   uint64_t     deltas;
+   uint64_t     max_deltas;
+   uint64_t     delta_hist[PROF_DELTA_BUCKETS];
+   uint64_t     start_ticks;
+   uint64_t     start_ns;
+} profile_t;
+
+typedef const char *(*prof_name_fn_t)(unsigned index);
+
+profile_t *profile_new(unsigned nprocs, unsigned ngroups);
+void profile_free(profile_t *p);
+void profile_set_source(profile_t *p, unsigned proc, tree_t source);
+void profile_time_step(profile_t *p, unsigned deltas);
+void profile_report(profile_t *p, const char *json, prof_name_fn_t group_name);
+
+static inline uint64_t profile_ticks(void)
+{
+#if defined __x86_64__ || defined __i386__
+   return __builtin_ia32_rdtsc();
+#else
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (uint64_t)ts.tv_sec * UINT64_C(1000000000) + ts.tv_nsec;
+#endif
+}
+
+static inline void profile_run(profile_t *p, unsigned proc, uint64_t ticks)
+{
+   p->procs[proc].runs++;
+   p->procs[proc].ticks += ticks;
+}
+
+static inline void profile_wakeup(profile_t *p, unsigned proc,
+                                  prof_wake_t why)
+{
+   p->procs[proc].wakeups[why]++;
+}
+
+static inline void profile_group_event(profile_t *p, unsigned group)
+{
+   p->group_events[group]++;
+}
+
+#endif  // _PROFILE_H
@@ -65,7 +65,8 @@ typedef enum {
    NET_F_FORCED     = (1 << 2),
    NET_F_OWNS_MEM   = (1 << 3),
    NET_F_GLOBAL     = (1 << 4),
-   NET_F_LAST_VALUE = (1 << 5)
+   NET_F_LAST_VALUE = (1 << 5),
+   NET_F_COMB       = (1 << 6)
 } net_flags_t;
 
 typedef enum {
@@ -73,6 +74,20 @@ typedef enum {
    SCHED_STATIC     = (1 << 1)
 } sched_flags_t;
 
+// The upper bits of the _sched_event flags are a mask of the values of
+// a scalar signal that wake the process or zero to wake on any event
+#define SCHED_EDGE_SHIFT 16
+#define SCHED_EDGE_LITS  16
+
+// Value of the "clock" attribute on processes that toggle a signal
+// with a fixed period which the kernel runs without calling the
+// generated code
+typedef enum {
+   CLOCK_NONE,
+   CLOCK_AFTER,   // S <= not S after T; with static wait on S
+   CLOCK_WAIT     // S <= not S; wait for T;
+} clock_kind_t;
+
 typedef enum {
    RT_START_OF_SIMULATION,
    RT_END_OF_SIMULATION,
@@ -109,15 +124,24 @@ bool rt_can_create_delta(void);
 uint64_t rt_now(unsigned *deltas);
 void rt_stop(void);
 void rt_set_exit_severity(rt_severity_t severity);
+void rt_set_checkpoint(uint64_t when, const char *fname);
+void rt_restore(tree_t top, const char *fname);
+int rt_fork_batch(tree_t top, const char *list, unsigned jobs,
+                  uint64_t stop_time);
 
 void jit_init(ident_t top);
 void jit_shutdown(void);
 void *jit_fun_ptr(const char *name, bool required);
 void *jit_var_ptr(const char *name, bool required);
 void jit_bind_fn(const char *name, void *ptr);
+void jit_write_perf_map(void);
 
 void shell_run(tree_t top, tree_rd_ctx_t ctx);
 
+void trace_filter_proc(const char *glob);
+void trace_filter_signal(const char *glob);
+void trace_decode(const char *fname, bool csv);
+
 text_buf_t *pprint(struct tree *t, const uint64_t *values, size_t len);
 
 void vcd_init(const char *file, struct tree *top);
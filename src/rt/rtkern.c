@@ -21,10 +21,15 @@
 #include "util.h"
 #include "alloc.h"
 #include "heap.h"
+#include "wheel.h"
 #include "common.h"
 #include "netdb.h"
 #include "cover.h"
 #include "hash.h"
+#include "simd.h"
+#include "profile.h"
+#include "trace.h"
+#include "fbuf.h"
 
 #include <assert.h>
 #include <stdint.h>
@@ -37,20 +42,41 @@
 #include <errno.h>
 #include <signal.h>
 #include <sys/time.h>
+#include <time.h>
 #include <sys/resource.h>
 #include <float.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <ctype.h>
+#include <limits.h>
+#include <sys/wait.h>
 
 #ifdef HAVE_ALLOCA_H
 #include <alloca.h>
 #endif
 
+#ifdef HAVE_LINUX_PERF_EVENT_H
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#endif
+
 #define TRACE_DELTAQ  1
 #define TRACE_PENDING 0
 
+#define MAX_MEMO_LITS    256
+#define WAVE_RING_SIZE   3
+#define FOLD_MAX_LITS    16
+#define PENDING_SHIFT    6
+#define PENDING_LEVELS   ((32 + PENDING_SHIFT - 1) / PENDING_SHIFT + 1)
+
 typedef void (*proc_fn_t)(int32_t reset);
 typedef uint64_t (*resolution_fn_t)(void *vals, int32_t n);
+typedef void (*pool_fn_t)(unsigned id);
 
 typedef struct netgroup   netgroup_t;
+typedef struct netgroup_cold netgroup_cold_t;
 typedef struct driver     driver_t;
 typedef struct rt_proc    rt_proc_t;
 typedef struct event      event_t;
@@ -60,71 +86,120 @@ typedef struct value      value_t;
 typedef struct watch_list watch_list_t;
 typedef struct res_memo   res_memo_t;
 typedef struct callback   callback_t;
+typedef struct stage      stage_t;
+typedef struct batch_slot batch_slot_t;
 
 struct rt_proc {
-   tree_t    source;
-   proc_fn_t proc_fn;
-   uint32_t  wakeup_gen;
-   bool      postponed;
+   tree_t       source;
+   proc_fn_t    proc_fn;
+   uint32_t     wakeup_gen;
+   bool         postponed;
+   bool         parallel;
+   bool         batched;
+   clock_kind_t clock_kind;
+   netgroup_t  *clock_group;
+   uint64_t     clock_period;
+   uint64_t     clock_reject;
+   uint32_t     comb_level;
+   bool         comb_queued;
+   event_t     *timeout;
+   sens_list_t *sens_head;
+   sens_list_t *sens_tail;
+   sens_list_t *sens_cursor;
 };
 
+typedef struct {
+   void     *base;
+   uint32_t  alloc;
+} tmp_stack_t;
+
 typedef enum {
    E_TIMEOUT,
    E_DRIVER,
    E_PROCESS
 } event_kind_t;
 
+// Events refer to the process, group, or timeout callback they act on
+// by a 32-bit index whose meaning depends on the kind so that the many
+// pending events in a busy design take as little memory as possible
 struct event {
-   uint64_t      when;
-   event_kind_t  kind;
-   uint32_t      wakeup_gen;
-   event_t      *delta_chain;
-   rt_proc_t    *proc;
-   netgroup_t   *group;
-   timeout_fn_t  timeout_fn;
-   void         *timeout_user;
+   uint64_t  when;
+   uint32_t  handle;
+   uint32_t  wakeup_gen;
+   uint32_t  index;
+   uint8_t   kind;
+   bool      force;
 };
 
 struct waveform {
    uint64_t    when;
    waveform_t *next;
-   value_t    *values;
+   event_t    *event;
+   union {
+      value_t  *values;
+      uint64_t  inline_data;
+   };
 };
 
 struct sens_list {
    rt_proc_t    *proc;
    sens_list_t  *next;
    sens_list_t **reenq;
+   sens_list_t **list;
+   sens_list_t  *proc_next;
+   sens_list_t  *proc_prev;
    uint32_t      wakeup_gen;
    netid_t       first;
    netid_t       last;
+   uint16_t      edge_mask;
 };
 
+// The current value and first pending transactions of each driver are
+// held in a small ring and any later transactions spill to a list
+
 struct driver {
    rt_proc_t  *proc;
-   waveform_t *waveforms;
+   waveform_t *spill;
+   uint8_t     head;
+   uint8_t     count;
+   waveform_t  ring[WAVE_RING_SIZE];
 };
 
+typedef struct {
+   value_t    *values;
+   waveform_t *spill;
+} retired_t;
+
 struct value {
-   value_t *next;
-   char     data[0];
+   char data[0];
 };
 
+// Fields used by every transaction are kept in groups[] which is
+// aligned so each entry occupies a single cache line. The rest are in
+// a parallel array indexed by group ID.
+
 struct netgroup {
-   netid_t       first;
-   uint32_t      length;
-   net_flags_t   flags;
-   void         *resolved;
+   netid_t           first;
+   uint32_t          length;
+   net_flags_t       flags;
+   uint16_t          size;
+   uint16_t          n_drivers;
+   uint8_t           pack;
+   bool              inline_values;
+   void             *resolved;
+   driver_t         *drivers;
+   res_memo_t       *resolution;
+   rt_alloc_stack_t  value_slab;
+   sens_list_t      *pending;
+};
+
+struct netgroup_cold {
    void         *last_value;
    value_t      *forcing;
-   uint16_t      size;
-   uint16_t      n_drivers;
-   driver_t     *drivers;
-   res_memo_t   *resolution;
    uint64_t      last_event;
+   uint32_t      driver_mask;
+   uint16_t     *driver_map;
    tree_t        sig_decl;
-   value_t      *free_values;
-   sens_list_t  *pending;
    watch_list_t *watching;
 };
 
@@ -149,6 +224,12 @@ struct run_queue {
    size_t    alloc;
 };
 
+struct delta_queue {
+   event_t **queue;
+   size_t    count;
+   size_t    alloc;
+};
+
 struct watch {
    tree_t         signal;
    sig_event_fn_t fn;
@@ -171,13 +252,15 @@ struct watch_list {
 typedef enum {
    R_MEMO  = (1 << 0),
    R_IDENT = (1 << 1),
+   R_FOLD  = (1 << 2),
 } res_flags_t;
 
 struct res_memo {
    resolution_fn_t fn;
    res_flags_t     flags;
-   int8_t          tab2[16][16];
-   int8_t          tab1[16];
+   unsigned        nlits;
+   uint8_t        *tab2;
+   uint8_t         tab1[MAX_MEMO_LITS];
 };
 
 typedef enum {
@@ -192,37 +275,69 @@ struct callback {
    callback_t    *next;
 };
 
+struct timeout_cb {
+   timeout_fn_t  fn;
+   void         *user;
+   uint32_t      next_free;
+};
+
+struct stage {
+   uint8_t *buf;
+   size_t   used;
+   size_t   alloc;
+};
+
+struct batch_slot {
+   rt_proc_t   *proc;
+   sens_list_t *wakeup;
+   stage_t      stage;
+};
+
 static struct rt_proc   *procs = NULL;
-static struct rt_proc   *active_proc = NULL;
+static __thread struct rt_proc *active_proc = NULL;
 static struct loaded    *loaded = NULL;
 static struct run_queue  run_queue;
 
 static heap_t        eventq_heap = NULL;
+static wheel_t       eventq_wheel = NULL;
+static bool          use_wheel = true;
+static bool          pack_signals = false;
 static size_t        n_procs = 0;
 static uint64_t      now = 0;
 static int           iteration = -1;
 static bool          trace_on = false;
 static tree_rd_ctx_t tree_rd_ctx = NULL;
+static ident_t       top_name = NULL;
 static nvc_rusage_t  ready_rusage;
+static uint64_t      ready_ns = 0;
 static jmp_buf       fatal_jmp;
 static bool          aborted = false;
 static netdb_t      *netdb = NULL;
 static netgroup_t   *groups = NULL;
-static sens_list_t  *pending = NULL;
+static netgroup_cold_t *groups_cold = NULL;
+static sens_list_t **pending = NULL;
+static unsigned      n_pending = 0;
+static unsigned      pending_levels = 0;
+static unsigned      pending_base[PENDING_LEVELS];
 static sens_list_t  *resume = NULL;
 static sens_list_t  *postponed = NULL;
 static watch_t      *watches = NULL;
 static watch_t      *callbacks = NULL;
-static event_t      *delta_proc = NULL;
-static event_t      *delta_driver = NULL;
+static struct delta_queue delta_proc;
+static struct delta_queue delta_driver;
 static void         *global_tmp_stack = NULL;
-static void         *proc_tmp_stack = NULL;
+static __thread void *proc_tmp_stack = NULL;
+static __thread tmp_stack_t tmp_stack;
 static uint32_t      global_tmp_alloc;
 static hash_t       *res_memo_hash = NULL;
 static side_effect_t init_side_effect = SIDE_EFFECT_ALLOW;
 static bool          force_stop;
 static bool          can_create_delta;
 static callback_t   *global_cbs[RT_LAST_EVENT];
+static struct timeout_cb *timeout_cbs = NULL;
+static uint32_t      timeout_alloc = 0;
+static uint32_t      timeout_used = 0;
+static uint32_t      timeout_free = UINT32_MAX;
 static rt_severity_t exit_severity = SEVERITY_ERROR;
 
 static rt_alloc_stack_t event_stack = NULL;
@@ -235,26 +350,130 @@ static netgroup_t **active_groups;
 static unsigned     n_active_groups = 0;
 static unsigned     n_active_alloc = 0;
 
-static void deltaq_insert_proc(uint64_t delta, rt_proc_t *wake);
-static void deltaq_insert_driver(uint64_t delta, netgroup_t *group,
-                                 rt_proc_t *driver);
-static bool rt_sched_driver(netgroup_t *group, uint64_t after,
-                            uint64_t reject, value_t *values);
+static uint64_t     n_cancelled = 0;
+static uint64_t     n_events = 0;
+static uint64_t     n_deltas = 0;
+static uint64_t     n_coalesced = 0;
+static uint64_t     n_filtered = 0;
+static uint64_t     n_clock_ticks = 0;
+static size_t       event_peak = 0;
+static unsigned     trim_steps = 0;
+static int          cache_fd = -1;
+static uint64_t     cache_misses = 0;
+static uint64_t     cache_max = 0;
+static uint64_t     cache_cycles = 0;
+static simd_level_t simd_level = SIMD_SCALAR;
+static profile_t   *profile = NULL;
+static bool         btrace_on = false;
+static uint64_t     heartbeat_ns = 0;
+static uint64_t     heartbeat_next = 0;
+static FILE        *heartbeat_file = NULL;
+static uint64_t     checkpoint_at = UINT64_MAX;
+static char        *checkpoint_fname = NULL;
+static bool         wave_restart = false;
+
+static volatile sig_atomic_t heartbeat_signal = 0;
+
+static struct {
+   uint64_t ns;
+   uint64_t now;
+   uint64_t events;
+   uint64_t deltas;
+} heartbeat_last;
+
+static unsigned         n_threads = 1;
+static pthread_t       *workers = NULL;
+static pthread_mutex_t  pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t   pool_cond = PTHREAD_COND_INITIALIZER;
+static pthread_mutex_t  serial_lock = PTHREAD_MUTEX_INITIALIZER;
+static unsigned         pool_gen = 0;
+static unsigned         pool_busy = 0;
+static bool             pool_quit = false;
+static pool_fn_t        pool_fn = NULL;
+static batch_slot_t    *batch = NULL;
+static unsigned         batch_len = 0;
+static unsigned         batch_alloc = 0;
+static unsigned         batch_next = 0;
+static uint64_t         n_batches = 0;
+static uint64_t         n_batched = 0;
+static event_t        **update_events = NULL;
+static int32_t         *update_flags = NULL;
+static retired_t       *update_retired = NULL;
+static stage_t         *update_stages = NULL;
+static unsigned         update_len = 0;
+static unsigned         update_alloc = 0;
+static uint64_t         n_update_batches = 0;
+static uint64_t         n_updated = 0;
+
+static __thread bool     in_pool = false;
+static __thread stage_t *active_stage = NULL;
+static __thread jmp_buf *trap_jmp = NULL;
+
+static bool          levelise = false;
+static bool          comb_settling = false;
+static unsigned      comb_levels = 0;
+static unsigned      comb_lo = UINT_MAX;
+static unsigned      comb_hi = 0;
+static sens_list_t **comb_ready = NULL;
+static netgroup_t  **comb_groups = NULL;
+static unsigned      n_comb_groups = 0;
+static unsigned      n_comb_alloc = 0;
+static unsigned      n_comb_procs = 0;
+static unsigned      n_comb_loops = 0;
+static uint64_t      n_comb_saved = 0;
+static event_t       comb_event;
+
+static event_t *deltaq_insert_proc(uint64_t delta, rt_proc_t *wake);
+static event_t *deltaq_insert_driver(uint64_t delta, netgroup_t *group,
+                                     rt_proc_t *driver);
+static void rt_sched_driver(netgroup_t *group, uint64_t after,
+                            uint64_t reject, const void *values);
 static void rt_sched_event(sens_list_t **list, netid_t first, netid_t last,
-                           rt_proc_t *proc, bool is_static);
+                           rt_proc_t *proc, bool is_static,
+                           uint16_t edge_mask);
+static bool rt_comb_internal(netgroup_t *group);
 static void *rt_tmp_alloc(size_t sz);
 static value_t *rt_alloc_value(netgroup_t *g);
+static void rt_set_wave_value(netgroup_t *g, waveform_t *w, const void *src);
+static int rt_find_driver(const netgroup_t *g, const rt_proc_t *proc);
+static void rt_map_driver(netgroup_t *g, int driver);
+static size_t rt_value_size(const netgroup_t *g);
+static int rt_pack_bits(type_t type);
+static void rt_write_value(const netgroup_t *g, void *dst, const void *src);
+static void rt_unpack_value(const netgroup_t *g, uint8_t *dst,
+                            const void *src, int first, int count);
 static tree_t rt_recall_tree(const char *unit, int32_t where);
 static res_memo_t *rt_memo_resolution_fn(type_t type, resolution_fn_t fn);
 static void _tracef(const char *fmt, ...);
 
+static inline unsigned rt_pending_block(unsigned level, netid_t nid)
+{
+   // Each level of the global pending list has blocks 64 times larger
+   // than the one below and the top level is a single block
+   const unsigned shift = PENDING_SHIFT * (level + 1);
+   return pending_base[level] + ((shift < 32) ? nid >> shift : 0);
+}
+
 #define GLOBAL_TMP_STACK_SZ (256 * 1024)
 #define PROC_TMP_STACK_SZ   (64 * 1024)
+#define MIN_PARALLEL_BATCH  8
+#define MIN_PARALLEL_UPDATE 64
+#define POOL_SPIN_LIMIT     10000
+#define MIN_PACK_LENGTH     8
+#define DRIVER_SCAN_LIMIT   4
+#define GROUP_ALIGN         64
+#define SLAB_TRIM_STEPS     1024
 
 #define TRACE(...) do {                                 \
       if (unlikely(trace_on)) _tracef(__VA_ARGS__);     \
    } while (0)
 
+#define BTRACE(kind, proc, group, value, len) do {                      \
+      if (unlikely(btrace_on))                                          \
+         trace_record((kind), now, MAX(iteration, 0), (proc), (group),  \
+                      (value), (len));                                  \
+   } while (0)
+
 #define FOR_ALL_SIZES(size, macro) do {                 \
       switch (size) {                                   \
       case 1:                                           \
@@ -271,6 +490,11 @@ static void _tracef(const char *fmt, ...);
 ////////////////////////////////////////////////////////////////////////////////
 // Utilities
 
+static inline netgroup_cold_t *rt_cold(const netgroup_t *g)
+{
+   return &(groups_cold[g - groups]);
+}
+
 static const char *fmt_group(const netgroup_t *g)
 {
    static const size_t BUF_LEN = 512;
@@ -279,14 +503,16 @@ static const char *fmt_group(const netgroup_t *g)
    const char *eptr = buf + BUF_LEN;
    char *p = buf;
 
-   p += checked_sprintf(p, eptr - p, "%s", istr(tree_ident(g->sig_decl)));
+   tree_t decl = rt_cold(g)->sig_decl;
+
+   p += checked_sprintf(p, eptr - p, "%s", istr(tree_ident(decl)));
 
-   groupid_t sig_group0 = netdb_lookup(netdb, tree_net(g->sig_decl, 0));
+   groupid_t sig_group0 = netdb_lookup(netdb, tree_net(decl, 0));
    netid_t sig_net0 = groups[sig_group0].first;
    int offset = g->first - sig_net0;
 
    const int length = g->length;
-   type_t type = tree_type(g->sig_decl);
+   type_t type = tree_type(decl);
    while (type_is_array(type)) {
       const int stride = type_width(type_elem(type));
       const int ndims = type_dims(type);
@@ -318,6 +544,16 @@ static const char *fmt_group(const netgroup_t *g)
    return buf;
 }
 
+static const char *rt_group_name(unsigned index)
+{
+   return fmt_group(&(groups[index]));
+}
+
+static const char *rt_proc_name(unsigned index)
+{
+   return istr(tree_ident(procs[index].source));
+}
+
 static const char *fmt_net(netid_t nid)
 {
    return fmt_group(&(groups[netdb_lookup(netdb, nid)]));
@@ -343,16 +579,291 @@ static inline uint64_t heap_key(uint64_t when, event_kind_t kind)
    return (when << 2) | (kind & 3);
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// Future event queue
+
+// Events in the future are either kept in a binary heap or a
+// hierarchical timing wheel depending on the --event-queue option
+
+static void eventq_new(void)
+{
+   if (use_wheel)
+      eventq_wheel = wheel_new();
+   else
+      eventq_heap = heap_new(512);
+}
+
+static void eventq_free(void)
+{
+   if (eventq_wheel != NULL)
+      wheel_free(eventq_wheel);
+   if (eventq_heap != NULL)
+      heap_free(eventq_heap);
+
+   eventq_wheel = NULL;
+   eventq_heap  = NULL;
+}
+
+static inline uint32_t eventq_insert(uint64_t key, event_t *e)
+{
+   if (likely(use_wheel))
+      return wheel_insert(eventq_wheel, key, e);
+   else
+      return heap_insert(eventq_heap, key, e);
+}
+
+static inline void eventq_delete(uint32_t handle)
+{
+   if (likely(use_wheel))
+      wheel_delete(eventq_wheel, handle);
+   else
+      heap_delete(eventq_heap, handle);
+}
+
+static inline event_t *eventq_min(void)
+{
+   if (likely(use_wheel))
+      return wheel_min(eventq_wheel);
+   else
+      return heap_min(eventq_heap);
+}
+
+static inline event_t *eventq_extract_min(void)
+{
+   if (likely(use_wheel))
+      return wheel_extract_min(eventq_wheel);
+   else
+      return heap_extract_min(eventq_heap);
+}
+
+static inline size_t eventq_size(void)
+{
+   if (likely(use_wheel))
+      return wheel_size(eventq_wheel);
+   else
+      return heap_size(eventq_heap);
+}
+
+#if TRACE_DELTAQ > 0
+static void eventq_walk(heap_walk_fn_t fn, void *context)
+{
+   if (use_wheel)
+      wheel_walk(eventq_wheel, fn, context);
+   else
+      heap_walk(eventq_heap, fn, context);
+}
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+// Staged process side effects
+
+// A process running on a worker thread cannot update the shared kernel
+// state directly. Instead each runtime call with a side effect appends
+// a record to the stage buffer for that process and the records are
+// replayed on the main thread once the whole batch has finished. Doing
+// this in run queue order gives exactly the same result as running the
+// processes one after another. Runtime errors are staged in the same
+// way so the first error reported is the one serial execution would hit.
+// Resolution functions called while updating groups in parallel are
+// staged in the same way with one buffer for each group.
+
+typedef enum {
+   STAGE_PROCESS,
+   STAGE_WAVEFORM,
+   STAGE_EVENT,
+   STAGE_ASSERT,
+   STAGE_TRAP
+} stage_kind_t;
+
+typedef enum {
+   TRAP_BOUNDS,
+   TRAP_DIV_ZERO,
+   TRAP_NULL_DEREF,
+   TRAP_VALUE_ATTR,
+   TRAP_BIT_VEC
+} trap_kind_t;
+
+typedef struct {
+   stage_kind_t kind;
+   uint32_t     length;
+} stage_hdr_t;
+
+typedef struct {
+   stage_hdr_t hdr;
+   int64_t     delay;
+} stage_process_t;
+
+typedef struct {
+   stage_hdr_t hdr;
+   int32_t     n;
+   int64_t     after;
+   int64_t     reject;
+} stage_waveform_t;
+
+typedef struct {
+   stage_hdr_t hdr;
+   int32_t     n;
+   int32_t     flags;
+} stage_event_t;
+
+typedef struct {
+   stage_hdr_t  hdr;
+   int32_t      msg_len;
+   int32_t      where;
+   int8_t       severity;
+   const char  *module;
+} stage_assert_t;
+
+typedef struct {
+   stage_hdr_t  hdr;
+   trap_kind_t  trap;
+   int32_t      args[6];
+   const char  *module;
+} stage_trap_t;
+
+static void *rt_stage_alloc(stage_kind_t kind, size_t hdrsz, size_t extra)
+{
+   // Records are followed by extra bytes of data and padded so the
+   // next record is suitably aligned
+
+   const size_t length = (hdrsz + extra + 7) & ~7;
+
+   stage_t *s = active_stage;
+   if (unlikely(s->used + length > s->alloc)) {
+      s->alloc = MAX(s->alloc * 2, MAX(s->used + length, 256));
+      s->buf   = xrealloc(s->buf, s->alloc);
+   }
+
+   stage_hdr_t *hdr = (stage_hdr_t *)(s->buf + s->used);
+   hdr->kind   = kind;
+   hdr->length = length;
+
+   s->used += length;
+   return hdr;
+}
+
+static void rt_stage_process(int64_t delay)
+{
+   stage_process_t *r =
+      rt_stage_alloc(STAGE_PROCESS, sizeof(stage_process_t), 0);
+   r->delay = delay;
+}
+
+static void rt_stage_waveform(const int32_t *nids, const void *values,
+                              int32_t n, int64_t after, int64_t reject)
+{
+   // Every element has the same size as the first valid net
+   size_t size = 0;
+   for (int i = 0; (i < n) && (size == 0); i++) {
+      if (nids[i] != NETID_INVALID)
+         size = groups[netdb_lookup(netdb, nids[i])].size;
+   }
+
+   const size_t idbytes = n * sizeof(int32_t);
+   const size_t nbytes  = n * size;
+
+   stage_waveform_t *r = rt_stage_alloc(STAGE_WAVEFORM,
+                                        sizeof(stage_waveform_t),
+                                        idbytes + nbytes);
+   r->n      = n;
+   r->after  = after;
+   r->reject = reject;
+
+   memcpy(r + 1, nids, idbytes);
+   memcpy((uint8_t *)(r + 1) + idbytes, values, nbytes);
+}
+
+static void rt_stage_event(const int32_t *nids, int32_t n, int32_t flags)
+{
+   const size_t idbytes = n * sizeof(int32_t);
+
+   stage_event_t *r =
+      rt_stage_alloc(STAGE_EVENT, sizeof(stage_event_t), idbytes);
+   r->n     = n;
+   r->flags = flags;
+
+   memcpy(r + 1, nids, idbytes);
+}
+
+static void rt_stage_assert(const uint8_t *msg, int32_t msg_len,
+                            int8_t severity, int32_t where,
+                            const char *module)
+{
+   // A negative length means the message is a C string
+   const size_t nbytes =
+      (msg_len >= 0) ? msg_len : strlen((const char *)msg) + 1;
+
+   stage_assert_t *r =
+      rt_stage_alloc(STAGE_ASSERT, sizeof(stage_assert_t), nbytes);
+   r->msg_len  = msg_len;
+   r->where    = where;
+   r->severity = severity;
+   r->module   = module;
+
+   memcpy(r + 1, msg, nbytes);
+
+   // The simulation will stop when this is replayed so there is no
+   // point running the rest of the process
+   if (severity >= exit_severity)
+      longjmp(*trap_jmp, 1);
+}
+
+static void rt_stage_trap(trap_kind_t trap, const char *module,
+                          const int32_t *args, int nargs,
+                          const void *data, size_t nbytes)
+{
+   assert(nargs <= ARRAY_LEN(((stage_trap_t *)NULL)->args));
+
+   stage_trap_t *r =
+      rt_stage_alloc(STAGE_TRAP, sizeof(stage_trap_t), nbytes);
+   r->trap   = trap;
+   r->module = module;
+
+   memcpy(r->args, args, nargs * sizeof(int32_t));
+   if (nbytes > 0)
+      memcpy(r + 1, data, nbytes);
+
+   // Abandon the process: the error is raised during replay
+   longjmp(*trap_jmp, 1);
+}
+
+static inline void rt_serial_begin(void)
+{
+   // Serialise calls from worker threads to functions which use
+   // unsynchronised global state such as the tree reader
+   if (in_pool)
+      pthread_mutex_lock(&serial_lock);
+}
+
+static inline void rt_serial_end(void)
+{
+   if (in_pool)
+      pthread_mutex_unlock(&serial_lock);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // Runtime support functions
 
-void     *_tmp_stack;
-uint32_t  _tmp_alloc;
+tmp_stack_t *_tmp_stack(void)
+{
+   // Generated code cannot refer to thread local variables in the
+   // runtime as the JIT does not relocate them so it calls this to find
+   // the temporary stack for the current thread
+
+   return &tmp_stack;
+}
 
 void _sched_process(int64_t delay)
 {
+   if (unlikely(active_stage != NULL)) {
+      rt_stage_process(delay);
+      return;
+   }
+
    TRACE("_sched_process delay=%s", fmt_time(delay));
-   deltaq_insert_proc(delay, active_proc);
+
+   assert(active_proc->timeout == NULL);
+   active_proc->timeout = deltaq_insert_proc(delay, active_proc);
 }
 
 void _sched_waveform(void *_nids, void *values, int32_t n,
@@ -360,6 +871,11 @@ void _sched_waveform(void *_nids, void *values, int32_t n,
 {
    const int32_t *nids = _nids;
 
+   if (unlikely(active_stage != NULL)) {
+      rt_stage_waveform(nids, values, n, after, reject);
+      return;
+   }
+
    TRACE("_sched_waveform %s values=%s n=%d after=%s reject=%s",
          fmt_net(nids[0]),
          fmt_values(values, n * groups[netdb_lookup(netdb, nids[0])].size),
@@ -375,12 +891,8 @@ void _sched_waveform(void *_nids, void *values, int32_t n,
       if (likely(nid != NETID_INVALID)) {
          netgroup_t *g = &(groups[netdb_lookup(netdb, nid)]);
 
-         value_t *values_copy = rt_alloc_value(g);
-         memcpy(values_copy->data, (uint8_t *)values + (offset * g->size),
-                g->size * g->length);
-
-         if (!rt_sched_driver(g, after, reject, values_copy))
-            deltaq_insert_driver(after, g, active_proc);
+         rt_sched_driver(g, after, reject,
+                         (uint8_t *)values + (offset * g->size));
 
          offset += g->length;
       }
@@ -395,6 +907,11 @@ void _sched_event(void *_nids, int32_t n, int32_t flags)
 {
    const int32_t *nids = _nids;
 
+   if (unlikely(active_stage != NULL)) {
+      rt_stage_event(nids, n, flags);
+      return;
+   }
+
    TRACE("_sched_event %s n=%d flags=%d proc %s", fmt_net(nids[0]), n,
          flags, istr(tree_ident(active_proc->source)));
 
@@ -402,14 +919,23 @@ void _sched_event(void *_nids, int32_t n, int32_t flags)
 
    if (g0->length == n) {
       rt_sched_event(&(g0->pending), NETID_INVALID, NETID_INVALID,
-                     active_proc, flags & SCHED_STATIC);
+                     active_proc, flags & SCHED_STATIC,
+                     flags >> SCHED_EDGE_SHIFT);
    }
    else {
       const bool global = !!(flags & SCHED_SEQUENTIAL);
       if (global) {
-         // Place on the global pending list
-         rt_sched_event(&pending, nids[0], nids[n - 1], active_proc,
-                        flags & SCHED_STATIC);
+         // Place on the global pending list for the smallest block
+         // of nets containing the whole range
+         const netid_t first = MIN(nids[0], nids[n - 1]);
+         const netid_t last  = MAX(nids[0], nids[n - 1]);
+         unsigned level = 0;
+         while ((level + 1 < pending_levels)
+                && (rt_pending_block(level, first)
+                    != rt_pending_block(level, last)))
+            level++;
+         rt_sched_event(&(pending[rt_pending_block(level, first)]),
+                        first, last, active_proc, flags & SCHED_STATIC, 0);
       }
 
       int offset = 0;
@@ -420,7 +946,7 @@ void _sched_event(void *_nids, int32_t n, int32_t flags)
          else {
             // Place on the net group's pending list
             rt_sched_event(&(g->pending), NETID_INVALID, NETID_INVALID,
-                           active_proc, flags & SCHED_STATIC);
+                           active_proc, flags & SCHED_STATIC, 0);
          }
 
          offset += g->length;
@@ -446,18 +972,13 @@ void _alloc_driver(const int32_t *all_nets, int32_t all_length,
       netgroup_t *g = &(groups[netdb_lookup(netdb, driven_nets[offset])]);
       offset += g->length;
 
-      // Try to find this process in the list of existing drivers
-      int driver;
-      for (driver = 0; driver < g->n_drivers; driver++) {
-         if (likely(g->drivers[driver].proc == active_proc))
-            break;
-      }
-
       // Allocate memory for drivers on demand
-      if (driver == g->n_drivers) {
+      if (rt_find_driver(g, active_proc) == -1) {
+         const int driver = g->n_drivers;
+
          if ((g->n_drivers == 1) && (g->resolution == NULL))
-            fatal_at(tree_loc(g->sig_decl), "group %s has multiple drivers "
-                     "but no resolution function", fmt_group(g));
+            fatal_at(tree_loc(rt_cold(g)->sig_decl), "group %s has multiple "
+                     "drivers but no resolution function", fmt_group(g));
 
          const size_t driver_sz = sizeof(struct driver);
          g->drivers = xrealloc(g->drivers, (driver + 1) * driver_sz);
@@ -471,16 +992,20 @@ void _alloc_driver(const int32_t *all_nets, int32_t all_length,
          driver_t *d = &(g->drivers[driver]);
          d->proc = active_proc;
 
+         rt_map_driver(g, driver);
+
          const void *src = (init == NULL) ? g->resolved : initp;
 
          // Assign the initial value of the driver
-         waveform_t *dummy = rt_alloc(waveform_stack);
-         dummy->when   = 0;
-         dummy->next   = NULL;
-         dummy->values = rt_alloc_value(g);
-         memcpy(dummy->values->data, src, g->length * g->size);
-
-         d->waveforms = dummy;
+         waveform_t *w = &(d->ring[0]);
+         w->when  = 0;
+         w->next  = NULL;
+         w->event = NULL;
+         rt_set_wave_value(g, w, src);
+
+         d->head  = 0;
+         d->count = 1;
+         d->spill = NULL;
       }
 
       initp += g->length * g->size;
@@ -526,7 +1051,29 @@ void _set_initial(int32_t nid, const uint8_t *values, const int32_t *size_list,
    for (int i = 0; i < nparts; i++)
       total_size += size_list[i * 2] * size_list[(i * 2) + 1];
 
-   uint8_t *res_mem  = xmalloc(total_size * 2);
+   // The resolved value is read directly by generated code so is always
+   // one element per byte but the other copies of a wide bit or
+   // std_ulogic signal may be packed. Signals with a resolution function
+   // are never packed as every driver would have to be unpacked each
+   // time the signal is resolved.
+   int last_size = total_size;
+   if (pack_signals && (memo == NULL) && (nparts == 1)
+       && (size_list[0] == 1)) {
+      const int bits = rt_pack_bits(tree_type(decl));
+
+      int offset = 0;
+      while ((bits > 0) && (offset < total_size)) {
+         netgroup_t *g = &(groups[netdb_lookup(netdb, nid + offset)]);
+         if (g->length >= MIN_PACK_LENGTH) {
+            g->pack = bits;
+            last_size -= g->length - rt_value_size(g);
+         }
+
+         offset += g->length;
+      }
+   }
+
+   uint8_t *res_mem  = xmalloc(total_size + last_size);
    uint8_t *last_mem = res_mem + total_size;
 
    const uint8_t *src = values;
@@ -534,17 +1081,21 @@ void _set_initial(int32_t nid, const uint8_t *values, const int32_t *size_list,
    while (part < nparts) {
       groupid_t gid = netdb_lookup(netdb, nid + offset);
       netgroup_t *g = &(groups[gid]);
+      netgroup_cold_t *cold = &(groups_cold[gid]);
 
       const int size = size_list[part * 2];
 
-      assert(g->sig_decl == NULL);
+      assert(cold->sig_decl == NULL);
       assert(remain >= g->length);
 
-      g->sig_decl   = decl;
-      g->resolution = memo;
-      g->size       = size;
-      g->resolved   = res_mem;
-      g->last_value = last_mem;
+      cold->sig_decl   = decl;
+      cold->last_value = last_mem;
+      g->resolution    = memo;
+      g->size          = size;
+      g->resolved      = res_mem;
+      g->inline_values = (rt_value_size(g) <= sizeof(uint64_t));
+      g->value_slab    = g->inline_values ? NULL
+         : rt_slab_class(sizeof(struct value) + rt_value_size(g));
 
       if (offset == 0)
          g->flags |= NET_F_OWNS_MEM;
@@ -552,10 +1103,10 @@ void _set_initial(int32_t nid, const uint8_t *values, const int32_t *size_list,
       const int nbytes = g->length * size;
 
       res_mem += nbytes;
-      last_mem += nbytes;
+      last_mem += rt_value_size(g);
 
       memcpy(g->resolved, src, nbytes);
-      memcpy(g->last_value, src, nbytes);
+      rt_write_value(g, cold->last_value, src);
 
       offset += g->length;
       src    += nbytes;
@@ -589,6 +1140,11 @@ void _assert_fail(const uint8_t *msg, int32_t msg_len, int8_t severity,
       return;
    }
 
+   if (unlikely(active_stage != NULL)) {
+      rt_stage_assert(msg, msg_len, severity, where, module);
+      return;
+   }
+
    tree_t t = rt_recall_tree(module, where);
    const loc_t *loc = tree_loc(t);
    bool is_report = tree_attr_int(t, ident_new("is_report"), 0);
@@ -627,6 +1183,11 @@ void _assert_fail(const uint8_t *msg, int32_t msg_len, int8_t severity,
 void _bounds_fail(int32_t where, const char *module, int32_t value,
                   int32_t min, int32_t max, int32_t kind, int32_t hint)
 {
+   if (unlikely(active_stage != NULL)) {
+      const int32_t args[] = { where, value, min, max, kind, hint };
+      rt_stage_trap(TRAP_BOUNDS, module, args, 6, NULL, 0);
+   }
+
    tree_t t = rt_recall_tree(module, where);
    const loc_t *loc = tree_loc(t);
 
@@ -685,6 +1246,8 @@ void _bounds_fail(int32_t where, const char *module, int32_t value,
 int64_t _value_attr(const uint8_t *raw_str, int32_t str_len,
                     int32_t where, const char *module)
 {
+   rt_serial_begin();
+
    tree_t t = rt_recall_tree(module, where);
 
    char *str = xmalloc(str_len + 1);
@@ -692,22 +1255,37 @@ int64_t _value_attr(const uint8_t *raw_str, int32_t str_len,
    str[str_len] = '\0';
 
    int64_t result;
-   if (!parse_value(tree_type(t), str, &result))
+   if (!parse_value(tree_type(t), str, &result)) {
+      if (unlikely(active_stage != NULL)) {
+         const int32_t args[] = { str_len, where };
+         rt_serial_end();
+         rt_stage_trap(TRAP_VALUE_ATTR, module, args, 2, raw_str, str_len);
+      }
+
       fatal_at(tree_loc(t), "string \"%s\" is not a valid "
                "representation of type %s", str, type_pp(tree_type(t)));
+   }
 
    free(str);
+
+   rt_serial_end();
    return result;
 }
 
 void _div_zero(int32_t where, const char *module)
 {
+   if (unlikely(active_stage != NULL))
+      rt_stage_trap(TRAP_DIV_ZERO, module, &where, 1, NULL, 0);
+
    tree_t t = rt_recall_tree(module, where);
    fatal_at(tree_loc(t), "division by zero");
 }
 
 void _null_deref(int32_t where, const char *module)
 {
+   if (unlikely(active_stage != NULL))
+      rt_stage_trap(TRAP_NULL_DEREF, module, &where, 1, NULL, 0);
+
    tree_t t = rt_recall_tree(module, where);
    fatal_at(tree_loc(t), "null access dereference");
 }
@@ -741,10 +1319,10 @@ void *_vec_load(const int32_t *nids, void *where,
 
    assert((g->flags & NET_F_LAST_VALUE) || !last);
 
-   if (offset + g->length - skip > high) {
+   if ((offset + g->length - skip > high) && !(last && g->pack)) {
       // If the signal data is already contiguous return a pointer to
       // that rather than copying into the user buffer
-      void *r = unlikely(last) ? g->last_value : g->resolved;
+      void *r = unlikely(last) ? rt_cold(g)->last_value : g->resolved;
       return (uint8_t *)r + (skip * g->size);
    }
 
@@ -753,9 +1331,13 @@ void *_vec_load(const int32_t *nids, void *where,
       const int to_copy = MIN(high - offset + 1, g->length - skip);
       const int bytes   = to_copy * g->size;
 
-      const void *src = unlikely(last) ? g->last_value : g->resolved;
-
-      memcpy(p, (uint8_t *)src + (skip * g->size), bytes);
+      if (unlikely(last && g->pack))
+         rt_unpack_value(g, p, rt_cold(g)->last_value, skip, to_copy);
+      else {
+         const void *src =
+            unlikely(last) ? rt_cold(g)->last_value : g->resolved;
+         memcpy(p, (uint8_t *)src + (skip * g->size), bytes);
+      }
 
       offset += g->length - skip;
       p += bytes;
@@ -774,6 +1356,8 @@ void *_vec_load(const int32_t *nids, void *where,
 
 void _image(int64_t val, int32_t where, const char *module, struct uarray *u)
 {
+   rt_serial_begin();
+
    tree_t t = rt_recall_tree(module, where);
 
    type_t type = type_base_recur(tree_type(t));
@@ -813,6 +1397,8 @@ void _image(int64_t val, int32_t where, const char *module, struct uarray *u)
       fatal_at(tree_loc(t), "cannot use 'IMAGE with this type");
    }
 
+   rt_serial_end();
+
    u->ptr = buf;
    u->dims[0].left  = 1;
    u->dims[0].right = len;
@@ -831,27 +1417,32 @@ void _bit_shift(int32_t kind, const uint8_t *data, int32_t len,
 
    uint8_t *buf = rt_tmp_alloc(len);
 
-   for (int i = 0; i < len; i++) {
-      switch (kind) {
-      case BIT_SHIFT_SLL:
-         buf[i] = (i < len - shift) ? data[i + shift] : 0;
-         break;
-      case BIT_SHIFT_SRL:
-         buf[i] = (i >= shift) ? data[i - shift] : 0;
-         break;
-      case BIT_SHIFT_SLA:
-         buf[i] = (i < len - shift) ? data[i + shift] : data[len - 1];
-         break;
-      case BIT_SHIFT_SRA:
-         buf[i] = (i >= shift) ? data[i - shift] : data[0];
-         break;
-      case BIT_SHIFT_ROL:
-         buf[i] = (i < len - shift) ? data[i + shift] : data[(i + shift) % len];
-         break;
-      case BIT_SHIFT_ROR:
-         buf[i] = (i >= shift) ? data[i - shift] : data[len + i - shift];
-         break;
-      }
+   // Each shift is a copy of the retained elements plus a fill
+   switch (kind) {
+   case BIT_SHIFT_SLL:
+      memcpy(buf, data + shift, len - shift);
+      memset(buf + len - shift, 0, shift);
+      break;
+   case BIT_SHIFT_SRL:
+      memset(buf, 0, shift);
+      memcpy(buf + shift, data, len - shift);
+      break;
+   case BIT_SHIFT_SLA:
+      memcpy(buf, data + shift, len - shift);
+      memset(buf + len - shift, data[len - 1], shift);
+      break;
+   case BIT_SHIFT_SRA:
+      memset(buf, data[0], shift);
+      memcpy(buf + shift, data, len - shift);
+      break;
+   case BIT_SHIFT_ROL:
+      memcpy(buf, data + shift, len - shift);
+      memcpy(buf + len - shift, data, shift);
+      break;
+   case BIT_SHIFT_ROR:
+      memcpy(buf, data + len - shift, shift);
+      memcpy(buf + shift, data, len - shift);
+      break;
    }
 
    u->ptr = buf;
@@ -864,47 +1455,17 @@ void _bit_vec_op(int32_t kind, const uint8_t *left, int32_t left_len,
                  int8_t left_dir, const uint8_t *right, int32_t right_len,
                  int8_t right_dir, struct uarray *u)
 {
-   if ((kind != BIT_VEC_NOT) && (left_len != right_len))
+   if ((kind != BIT_VEC_NOT) && (left_len != right_len)) {
+      if (unlikely(active_stage != NULL)) {
+         const int32_t args[] = { left_len, right_len };
+         rt_stage_trap(TRAP_BIT_VEC, NULL, args, 2, NULL, 0);
+      }
+
       fatal("arguments to bit vector operation are not the same length");
+   }
 
    uint8_t *buf = rt_tmp_alloc(left_len);
-
-   switch (kind) {
-   case BIT_VEC_NOT:
-      for (int i = 0; i < left_len; i++)
-         buf[i] = !left[i];
-      break;
-
-   case BIT_VEC_AND:
-      for (int i = 0; i < left_len; i++)
-         buf[i] = left[i] && right[i];
-      break;
-
-   case BIT_VEC_OR:
-      for (int i = 0; i < left_len; i++)
-         buf[i] = left[i] || right[i];
-      break;
-
-   case BIT_VEC_XOR:
-      for (int i = 0; i < left_len; i++)
-         buf[i] = left[i] ^ right[i];
-      break;
-
-   case BIT_VEC_XNOR:
-      for (int i = 0; i < left_len; i++)
-         buf[i] = !(left[i] ^ right[i]);
-      break;
-
-   case BIT_VEC_NAND:
-      for (int i = 0; i < left_len; i++)
-         buf[i] = !(left[i] && right[i]);
-      break;
-
-   case BIT_VEC_NOR:
-      for (int i = 0; i < left_len; i++)
-         buf[i] = !(left[i] || right[i]);
-      break;
-   }
+   simd_bit_vec_op(kind, buf, left, right, left_len);
 
    u->ptr = buf;
    u->dims[0].left  = (left_dir == RANGE_TO) ? 0 : left_len - 1;
@@ -936,11 +1497,12 @@ int64_t _last_event(const int32_t *nids, int32_t n)
    int64_t last = INT64_MAX;
    int offset = 0;
    while (offset < n) {
-      netgroup_t *g = &(groups[netdb_lookup(netdb, nids[offset])]);
-      if (g->last_event < now)
-         last = MIN(last, now - g->last_event);
+      const groupid_t gid = netdb_lookup(netdb, nids[offset]);
+      const uint64_t last_event = groups_cold[gid].last_event;
+      if (last_event < now)
+         last = MIN(last, now - last_event);
 
-      offset += g->length;
+      offset += groups[gid].length;
    }
 
    return last;
@@ -1094,41 +1656,113 @@ static void _tracef(const char *fmt, ...)
    va_end(ap);
 }
 
-static void deltaq_insert(event_t *e)
+static inline bool deltaq_empty(void)
+{
+   return (delta_driver.count == 0) && (delta_proc.count == 0);
+}
+
+static void deltaq_push(struct delta_queue *q, event_t *e)
+{
+   if (unlikely(q->count == q->alloc)) {
+      q->alloc = MAX(q->alloc * 2, 128);
+      q->queue = xrealloc(q->queue, sizeof(event_t *) * q->alloc);
+   }
+
+   q->queue[(q->count)++] = e;
+}
+
+static inline rt_proc_t *rt_event_proc(const event_t *e)
+{
+   assert(e->kind == E_PROCESS);
+   return &(procs[e->index]);
+}
+
+static inline netgroup_t *rt_event_group(const event_t *e)
 {
-   if (e->when == now) {
-      event_t **chain = (e->kind == E_DRIVER) ? &delta_driver : &delta_proc;
-      e->delta_chain = *chain;
-      *chain = e;
+   assert(e->kind == E_DRIVER);
+   return &(groups[e->index]);
+}
+
+static uint32_t rt_timeout_new(timeout_fn_t fn, void *user)
+{
+   uint32_t index;
+   if (timeout_free != UINT32_MAX) {
+      index = timeout_free;
+      timeout_free = timeout_cbs[index].next_free;
    }
    else {
-      e->delta_chain = NULL;
-      heap_insert(eventq_heap, heap_key(e->when, e->kind), e);
+      if (unlikely(timeout_used == timeout_alloc)) {
+         timeout_alloc = MAX(timeout_alloc * 2, 16);
+         timeout_cbs = xrealloc(timeout_cbs,
+                                timeout_alloc * sizeof(struct timeout_cb));
+      }
+      index = timeout_used++;
    }
+
+   timeout_cbs[index].fn   = fn;
+   timeout_cbs[index].user = user;
+   return index;
+}
+
+static void rt_timeout_run(const event_t *e)
+{
+   // Release the slot first as the callback may schedule another
+   struct timeout_cb cb = timeout_cbs[e->index];
+   timeout_cbs[e->index].next_free = timeout_free;
+   timeout_free = e->index;
+
+   (*cb.fn)(now, cb.user);
+}
+
+static void deltaq_insert(event_t *e)
+{
+   if (e->when == now)
+      deltaq_push((e->kind == E_DRIVER) ? &delta_driver : &delta_proc, e);
+   else
+      e->handle = eventq_insert(heap_key(e->when, e->kind), e);
 }
 
-static void deltaq_insert_proc(uint64_t delta, rt_proc_t *wake)
+static event_t *deltaq_insert_proc(uint64_t delta, rt_proc_t *wake)
 {
    event_t *e = rt_alloc(event_stack);
    e->when       = now + delta;
    e->kind       = E_PROCESS;
-   e->proc       = wake;
+   e->index      = wake - procs;
+   e->force      = false;
    e->wakeup_gen = wake->wakeup_gen;
 
    deltaq_insert(e);
+   return e;
 }
 
-static void deltaq_insert_driver(uint64_t delta, netgroup_t *group,
-                                 rt_proc_t *driver)
+static event_t *deltaq_insert_driver(uint64_t delta, netgroup_t *group,
+                                     rt_proc_t *driver)
 {
    event_t *e = rt_alloc(event_stack);
    e->when       = now + delta;
    e->kind       = E_DRIVER;
-   e->group      = group;
-   e->proc       = driver;
+   e->index      = group - groups;
+   e->force      = (driver == NULL);
    e->wakeup_gen = UINT32_MAX;
 
    deltaq_insert(e);
+   return e;
+}
+
+static void deltaq_cancel(event_t *e)
+{
+   // Remove an event that can no longer have any effect. Events for the
+   // next delta cycle are cheap to discard when they run so these are
+   // left in place and ignored by rt_stale_event or rt_apply_group.
+
+   if (e->when > now) {
+      TRACE("cancel %s event at %s", (e->kind == E_DRIVER) ? "driver"
+            : "process", fmt_time(e->when));
+
+      eventq_delete(e->handle);
+      rt_free(event_stack, e);
+      n_cancelled++;
+   }
 }
 
 #if TRACE_DELTAQ > 0
@@ -1139,46 +1773,113 @@ static void deltaq_walk(uint64_t key, void *user, void *context)
    fprintf(stderr, "%s\t", fmt_time(e->when));
    switch (e->kind) {
    case E_DRIVER:
-      fprintf(stderr, "driver\t %s\n", fmt_group(e->group));
+      fprintf(stderr, "driver\t %s\n", fmt_group(rt_event_group(e)));
       break;
    case E_PROCESS:
-      fprintf(stderr, "process\t %s%s\n", istr(tree_ident(e->proc->source)),
-              (e->wakeup_gen == e->proc->wakeup_gen) ? "" : " (stale)");
+      {
+         rt_proc_t *proc = rt_event_proc(e);
+         fprintf(stderr, "process\t %s%s\n", istr(tree_ident(proc->source)),
+                 (e->wakeup_gen == proc->wakeup_gen) ? "" : " (stale)");
+      }
       break;
    case E_TIMEOUT:
-      fprintf(stderr, "timeout\t %p %p\n", e->timeout_fn, e->timeout_user);
+      fprintf(stderr, "timeout\t %p %p\n", timeout_cbs[e->index].fn,
+              timeout_cbs[e->index].user);
       break;
    }
 }
 
 static void deltaq_dump(void)
 {
-   for (event_t *e = delta_driver; e != NULL; e = e->delta_chain)
-      fprintf(stderr, "delta\tdriver\t %s\n", fmt_group(e->group));
+   for (size_t i = 0; i < delta_driver.count; i++)
+      fprintf(stderr, "delta\tdriver\t %s\n",
+              fmt_group(rt_event_group(delta_driver.queue[i])));
 
-   for (event_t *e = delta_proc; e != NULL; e = e->delta_chain)
+   for (size_t i = 0; i < delta_proc.count; i++) {
+      event_t *e = delta_proc.queue[i];
+      rt_proc_t *proc = rt_event_proc(e);
       fprintf(stderr, "delta\tprocess\t %s%s\n",
-              istr(tree_ident(e->proc->source)),
-              (e->wakeup_gen == e->proc->wakeup_gen) ? "" : " (stale)");
+              istr(tree_ident(proc->source)),
+              (e->wakeup_gen == proc->wakeup_gen) ? "" : " (stale)");
+   }
 
-   heap_walk(eventq_heap, deltaq_walk, NULL);
+   eventq_walk(deltaq_walk, NULL);
 }
 #endif
 
-static res_memo_t *rt_memo_resolution_fn(type_t type, resolution_fn_t fn)
+static bool rt_memo_can_fold(res_memo_t *memo)
 {
-   // Optimise some common resolution functions by memoising them
-
-   res_memo_t *memo = hash_get(res_memo_hash, fn);
-   if (memo != NULL)
-      return memo;
+   // A resolution function for any number of drivers can be computed by
+   // folding the two value table over the drivers if the table is
+   // commutative and associative and the function agrees with the fold
+   // for three and four drivers. The last check must be exhaustive so
+   // larger types are never folded.
 
-   if (type_is_array(type))
-      type = type_elem(type);
+   const unsigned n = memo->nlits;
+   const uint8_t *tab2 = memo->tab2;
 
-   memo = xmalloc(sizeof(res_memo_t));
-   memo->fn    = fn;
-   memo->flags = 0;
+   if (n > FOLD_MAX_LITS)
+      return false;
+
+   for (unsigned i = 0; i < n; i++) {
+      for (unsigned j = 0; j < i; j++) {
+         if (tab2[(i * n) + j] != tab2[(j * n) + i])
+            return false;
+      }
+   }
+
+   for (unsigned i = 0; i < n; i++) {
+      for (unsigned j = 0; j < n; j++) {
+         const unsigned ij = tab2[(i * n) + j];
+         for (unsigned k = 0; k < n; k++) {
+            const unsigned jk = tab2[(j * n) + k];
+            if (tab2[(ij * n) + k] != tab2[(i * n) + jk])
+               return false;
+         }
+      }
+   }
+
+   for (int nargs = 3; nargs <= 4; nargs++) {
+      uint8_t args[4] = { 0, 0, 0, 0 };
+      int carry;
+      do {
+         unsigned folded = args[0];
+         for (int a = 1; a < nargs; a++)
+            folded = tab2[(folded * n) + args[a]];
+
+         uint8_t copy[4];
+         memcpy(copy, args, sizeof(args));
+         if ((*memo->fn)(copy, nargs) != folded)
+            return false;
+
+         // Advance to the next combination of driver values
+         for (carry = 0; carry < nargs; carry++) {
+            if (++args[carry] < n)
+               break;
+            args[carry] = 0;
+         }
+      } while (carry < nargs);
+   }
+
+   return true;
+}
+
+static res_memo_t *rt_memo_resolution_fn(type_t type, resolution_fn_t fn)
+{
+   // Optimise some common resolution functions by memoising them
+
+   res_memo_t *memo = hash_get(res_memo_hash, fn);
+   if (memo != NULL)
+      return memo;
+
+   if (type_is_array(type))
+      type = type_elem(type);
+
+   memo = xmalloc(sizeof(res_memo_t));
+   memo->fn    = fn;
+   memo->flags = 0;
+   memo->nlits = 0;
+   memo->tab2  = NULL;
 
    hash_put(res_memo_hash, fn, memo);
 
@@ -1201,17 +1902,23 @@ static res_memo_t *rt_memo_resolution_fn(type_t type, resolution_fn_t fn)
       return memo;
    }
 
-   if (nlits > 16)
+   if (nlits > MAX_MEMO_LITS)
       return memo;
 
+   // Every enumeration with up to 256 literals is stored in one byte so
+   // the two value table is at most 64 kB
+
+   memo->nlits = nlits;
+   memo->tab2  = xmalloc(nlits * nlits);
+
    init_side_effect = SIDE_EFFECT_DISALLOW;
 
    // Memoise the function for all two value cases
 
    for (int i = 0; i < nlits; i++) {
       for (int j = 0; j < nlits; j++) {
-         int8_t args[2] = { i, j };
-         memo->tab2[i][j] = (*fn)(args, 2);
+         uint8_t args[2] = { i, j };
+         memo->tab2[(i * nlits) + j] = (*fn)(args, 2);
       }
    }
 
@@ -1220,15 +1927,23 @@ static res_memo_t *rt_memo_resolution_fn(type_t type, resolution_fn_t fn)
 
    bool identity = true;
    for (int i = 0; i < nlits; i++) {
-      int8_t args[1] = { i };
+      uint8_t args[1] = { i };
       memo->tab1[i] = (*fn)(args, 1);
       identity = identity && (memo->tab1[i] == i);
    }
 
+   const bool fold = rt_memo_can_fold(memo);
+
    if (init_side_effect != SIDE_EFFECT_OCCURRED) {
       memo->flags |= R_MEMO;
       if (identity)
          memo->flags |= R_IDENT;
+      if (fold)
+         memo->flags |= R_FOLD;
+   }
+   else {
+      free(memo->tab2);
+      memo->tab2 = NULL;
    }
 
    return memo;
@@ -1249,49 +1964,301 @@ static void rt_global_event(rt_event_t kind)
    }
 }
 
+static int rt_find_driver(const netgroup_t *g, const rt_proc_t *proc)
+{
+   // Return the index of the driver owned by proc or -1 if none
+
+   if (likely(g->n_drivers <= DRIVER_SCAN_LIMIT)) {
+      for (int i = 0; i < g->n_drivers; i++) {
+         if (g->drivers[i].proc == proc)
+            return i;
+      }
+      return -1;
+   }
+
+   const netgroup_cold_t *cold = rt_cold(g);
+   const uint32_t mask = cold->driver_mask;
+   for (uint32_t h = (proc - procs) & mask; cold->driver_map[h] != 0;
+        h = (h + 1) & mask) {
+      const int driver = cold->driver_map[h] - 1;
+      if (g->drivers[driver].proc == proc)
+         return driver;
+   }
+
+   return -1;
+}
+
+static void rt_map_driver(netgroup_t *g, int driver)
+{
+   // Groups with many drivers have an open addressing hash table from
+   // process index to driver index which is filled in as drivers are
+   // allocated during reset
+
+   if (g->n_drivers <= DRIVER_SCAN_LIMIT)
+      return;
+
+   netgroup_cold_t *cold = rt_cold(g);
+
+   const uint32_t size = next_power_of_2(g->n_drivers * 2);
+   int first = driver;
+   if ((cold->driver_map == NULL) || (size != cold->driver_mask + 1)) {
+      free(cold->driver_map);
+      cold->driver_map  = xmalloc(size * sizeof(uint16_t));
+      cold->driver_mask = size - 1;
+      memset(cold->driver_map, '\0', size * sizeof(uint16_t));
+      first = 0;
+   }
+
+   for (int i = first; i <= driver; i++) {
+      uint32_t h = (g->drivers[i].proc - procs) & cold->driver_mask;
+      while (cold->driver_map[h] != 0)
+         h = (h + 1) & cold->driver_mask;
+      cold->driver_map[h] = i + 1;
+   }
+}
+
+static size_t rt_value_size(const netgroup_t *g)
+{
+   if (g->pack != 0)
+      return ((g->length * g->pack) + 7) / 8;
+   else
+      return g->size * g->length;
+}
+
+static int rt_pack_bits(type_t type)
+{
+   // Number of bits needed for each element of a signal of this type
+   // in the packed representation or zero if it cannot be packed
+
+   if (type_is_array(type))
+      type = type_elem(type);
+
+   type_t base = type_base_recur(type);
+   if (type_kind(base) != T_ENUM)
+      return 0;
+
+   const int nlits = type_enum_literals(base);
+   if (nlits <= 2)
+      return 1;
+   else if (nlits <= 4)
+      return 2;
+   else if (nlits <= 16)
+      return 4;
+   else
+      return 0;
+}
+
+static void rt_pack_value(const netgroup_t *g, uint8_t *dst,
+                          const uint8_t *src)
+{
+   // Element i is stored in the low order bits first
+   const int per_byte = 8 / g->pack;
+   const size_t nbytes = rt_value_size(g);
+
+   int j = 0;
+   for (size_t i = 0; i < nbytes; i++) {
+      uint8_t b = 0;
+      for (int k = 0; (k < per_byte) && (j < g->length); k++, j++)
+         b |= src[j] << (k * g->pack);
+      dst[i] = b;
+   }
+}
+
+static void rt_unpack_value(const netgroup_t *g, uint8_t *dst,
+                            const void *src, int first, int count)
+{
+   const uint8_t *sp = src;
+   const unsigned mask = (1 << g->pack) - 1;
+   for (int j = 0; j < count; j++) {
+      const int bit = (first + j) * g->pack;
+      dst[j] = (sp[bit >> 3] >> (bit & 7)) & mask;
+   }
+}
+
+static void rt_write_value(const netgroup_t *g, void *dst, const void *src)
+{
+   // Store a value in the group's format from one in generated code
+
+   if (g->pack != 0)
+      rt_pack_value(g, dst, src);
+   else
+      memcpy(dst, src, g->size * g->length);
+}
+
 static value_t *rt_alloc_value(netgroup_t *g)
 {
-   if (g->free_values == NULL) {
-      value_t *v = xmalloc(sizeof(struct value) + (g->size * g->length));
-      v->next = NULL;
-      return v;
+   if (likely(g->value_slab != NULL))
+      return rt_alloc(g->value_slab);
+   else
+      return xmalloc(sizeof(struct value) + rt_value_size(g));
+}
+
+static void rt_free_value(netgroup_t *g, value_t *v)
+{
+   if (likely(g->value_slab != NULL))
+      rt_free(g->value_slab, v);
+   else
+      free(v);
+}
+
+static inline void *rt_wave_value(const netgroup_t *g, waveform_t *w)
+{
+   // Values no larger than a pointer are stored in the waveform itself
+   if (g->inline_values)
+      return &(w->inline_data);
+   else
+      return w->values->data;
+}
+
+static void rt_set_wave_value(netgroup_t *g, waveform_t *w, const void *src)
+{
+   if (g->inline_values) {
+      w->inline_data = 0;
+      rt_write_value(g, &(w->inline_data), src);
    }
    else {
-      value_t *v = g->free_values;
-      g->free_values = v->next;
-      v->next = NULL;
-      return v;
+      w->values = rt_alloc_value(g);
+      rt_write_value(g, w->values->data, src);
    }
 }
 
-static void rt_free_value(netgroup_t *g, value_t *v)
+static void rt_free_wave_value(netgroup_t *g, waveform_t *w)
+{
+   if (!g->inline_values)
+      rt_free_value(g, w->values);
+}
+
+static inline waveform_t *rt_driver_now(driver_t *d)
+{
+   return &(d->ring[d->head]);
+}
+
+static inline waveform_t *rt_driver_next(driver_t *d)
+{
+   // The spill list is only used when the ring is full
+   if (d->count > 1)
+      return &(d->ring[(d->head + 1) % WAVE_RING_SIZE]);
+   else
+      return NULL;
+}
+
+static inline void *rt_driver_value(netgroup_t *g, int driver)
+{
+   return rt_wave_value(g, rt_driver_now(&(g->drivers[driver])));
+}
+
+static void rt_driver_advance(netgroup_t *g, driver_t *d, retired_t *retired)
+{
+   // Make the first pending transaction the current value. This may be
+   // called on a worker thread so the old value and any spill node are
+   // passed back to be freed later. Retired values are always larger
+   // than a pointer so are chained through their own data.
+
+   waveform_t *old = rt_driver_now(d);
+   if (!g->inline_values) {
+      *(value_t **)old->values->data = retired->values;
+      retired->values = old->values;
+   }
+
+   d->head = (d->head + 1) % WAVE_RING_SIZE;
+   d->count--;
+
+   if (d->spill != NULL) {
+      // The ring was full so the old slot is now its tail
+      waveform_t *s = d->spill;
+      d->spill = s->next;
+      *old = *s;
+      old->next = NULL;
+      d->count++;
+
+      s->next = retired->spill;
+      retired->spill = s;
+   }
+}
+
+static void rt_free_retired(netgroup_t *g, retired_t *retired)
 {
-   assert(v->next == NULL);
-   v->next = g->free_values;
-   g->free_values = v;
+   while (retired->values != NULL) {
+      value_t *next = *(value_t **)retired->values->data;
+      rt_free_value(g, retired->values);
+      retired->values = next;
+   }
+
+   while (retired->spill != NULL) {
+      waveform_t *next = retired->spill->next;
+      rt_free(waveform_stack, retired->spill);
+      retired->spill = next;
+   }
 }
 
 static void *rt_tmp_alloc(size_t sz)
 {
    // Allocate sz bytes that will be freed by the active process
 
-   uint8_t *ptr = (uint8_t *)_tmp_stack + _tmp_alloc;
-   _tmp_alloc += sz;
+   uint8_t *ptr = (uint8_t *)tmp_stack.base + tmp_stack.alloc;
+   tmp_stack.alloc += sz;
    return ptr;
 }
 
+static void rt_sens_link(rt_proc_t *proc, sens_list_t *sl)
+{
+   // Each process keeps the entries it has on pending lists in the
+   // order they were added
+
+   sl->proc_next = NULL;
+   sl->proc_prev = proc->sens_tail;
+
+   if (proc->sens_tail == NULL)
+      proc->sens_head = sl;
+   else
+      proc->sens_tail->proc_next = sl;
+   proc->sens_tail = sl;
+}
+
+static void rt_sens_unlink(sens_list_t *sl)
+{
+   rt_proc_t *proc = sl->proc;
+
+   if (proc->sens_cursor == sl)
+      proc->sens_cursor = sl->proc_next;
+
+   if (sl->proc_prev == NULL)
+      proc->sens_head = sl->proc_next;
+   else
+      sl->proc_prev->proc_next = sl->proc_next;
+
+   if (sl->proc_next == NULL)
+      proc->sens_tail = sl->proc_prev;
+   else
+      sl->proc_next->proc_prev = sl->proc_prev;
+}
+
+static sens_list_t *rt_find_stale(sens_list_t **list, rt_proc_t *proc)
+{
+   // A process usually waits on the same signals in the same order so
+   // try the entry after the one last reused before searching all the
+   // entries for this process
+
+   sens_list_t *it = proc->sens_cursor;
+   if ((it != NULL) && (it->list == list)
+       && (it->wakeup_gen != proc->wakeup_gen))
+      return it;
+
+   for (it = proc->sens_head; it != NULL; it = it->proc_next) {
+      if ((it->list == list) && (it->wakeup_gen != proc->wakeup_gen))
+         return it;
+   }
+
+   return NULL;
+}
+
 static void rt_sched_event(sens_list_t **list, netid_t first, netid_t last,
-                           rt_proc_t *proc, bool is_static)
+                           rt_proc_t *proc, bool is_static,
+                           uint16_t edge_mask)
 {
    // See if there is already a stale entry in the pending
    // list for this process
-   sens_list_t *it = *list;
-   int count = 0;
-   for (; it != NULL; it = it->next, ++count) {
-      if ((it->proc == proc)
-          && (it->wakeup_gen != proc->wakeup_gen))
-         break;
-   }
+   sens_list_t *it = is_static ? NULL : rt_find_stale(list, proc);
 
    if (it == NULL) {
       sens_list_t *node = rt_alloc(sens_list_stack);
@@ -1300,46 +2267,106 @@ static void rt_sched_event(sens_list_t **list, netid_t first, netid_t last,
       node->next       = *list;
       node->first      = first;
       node->last       = last;
+      node->list       = list;
       node->reenq      = (is_static ? list : NULL);
+      node->edge_mask  = edge_mask;
+
+      // Static entries are never stale
+      if (!is_static)
+         rt_sens_link(proc, node);
 
       *list = node;
    }
    else {
       // Reuse the stale entry
-      assert(!is_static);
       it->wakeup_gen = proc->wakeup_gen;
       it->first      = first;
       it->last       = last;
+      it->edge_mask  = edge_mask;
+
+      proc->sens_cursor = it->proc_next;
    }
 }
 
 #if TRACE_PENDING
 static void rt_dump_pending(void)
 {
-   for (struct sens_list *it = pending; it != NULL; it = it->next) {
-      printf("%d..%d\t%s%s\n", it->first, it->last,
-             istr(tree_ident(it->proc->source)),
-             (it->wakeup_gen == it->proc->wakeup_gen) ? "" : " (stale)");
+   for (unsigned b = 0; b < n_pending; b++) {
+      for (struct sens_list *it = pending[b]; it != NULL; it = it->next) {
+         printf("[%u] %d..%d\t%s%s\n", b, it->first, it->last,
+                istr(tree_ident(it->proc->source)),
+                (it->wakeup_gen == it->proc->wakeup_gen) ? "" : " (stale)");
+      }
    }
 }
 #endif  // TRACE_PENDING
 
+static void rt_free_pending(void)
+{
+   for (unsigned b = 0; b < n_pending; b++) {
+      while (pending[b] != NULL) {
+         sens_list_t *next = pending[b]->next;
+         rt_free(sens_list_stack, pending[b]);
+         pending[b] = next;
+      }
+   }
+}
+
 static void rt_reset_group(groupid_t gid, netid_t first, unsigned length)
 {
    netgroup_t *g = &(groups[gid]);
    memset(g, '\0', sizeof(netgroup_t));
-   g->first       = first;
-   g->length      = length;
-   g->last_event  = INT64_MAX;
+   g->first  = first;
+   g->length = length;
+
+   netgroup_cold_t *cold = &(groups_cold[gid]);
+   memset(cold, '\0', sizeof(netgroup_cold_t));
+   cold->last_event = INT64_MAX;
 }
 
-static void rt_free_delta_events(event_t *e)
+static void rt_free_delta_events(struct delta_queue *q)
 {
-   while (e != NULL) {
-      event_t *tmp = e->delta_chain;
-      rt_free(event_stack, e);
-      e = tmp;
-   }
+   for (size_t i = 0; i < q->count; i++)
+      rt_free(event_stack, q->queue[i]);
+   q->count = 0;
+}
+
+static void rt_setup_clock(rt_proc_t *proc)
+{
+   // Free-running clock processes tagged by opt are reset by the
+   // generated code as usual but afterwards the kernel schedules each
+   // transaction itself
+
+   proc->clock_kind  = CLOCK_NONE;
+   proc->clock_group = NULL;
+
+   tree_t p = proc->source;
+   const clock_kind_t kind = tree_attr_int(p, clock_i, CLOCK_NONE);
+   if ((kind == CLOCK_NONE) || proc->postponed)
+      return;
+
+   tree_t assign = tree_stmt(p, 0);
+   tree_t delay = (kind == CLOCK_AFTER)
+      ? tree_delay(tree_waveform(assign, 0))
+      : tree_delay(tree_stmt(p, 1));
+
+   int64_t period, reject = 0;
+   if (!folded_int(delay, &period))
+      return;
+   else if (tree_has_reject(assign)
+            && !folded_int(tree_reject(assign), &reject))
+      return;
+
+   tree_t decl = tree_ref(tree_target(assign));
+   netgroup_t *g = &(groups[netdb_lookup(netdb, tree_net(decl, 0))]);
+   if ((g->length != 1) || (g->size != 1))
+      return;
+
+   proc->clock_kind   = kind;
+   proc->clock_group  = g;
+   proc->clock_period = period;
+   proc->clock_reject = reject;
+   proc->parallel     = false;
 }
 
 static void rt_setup(tree_t top)
@@ -1349,20 +2376,45 @@ static void rt_setup(tree_t top)
    active_proc = NULL;
    force_stop = false;
    can_create_delta = true;
+   batch_len = 0;
 
    assert(resume == NULL);
 
-   rt_free_delta_events(delta_proc);
-   rt_free_delta_events(delta_driver);
+   rt_free_delta_events(&delta_proc);
+   rt_free_delta_events(&delta_driver);
 
-   if (eventq_heap != NULL)
-      heap_free(eventq_heap);
-   eventq_heap = heap_new(512);
+   eventq_free();
+   eventq_new();
+
+   timeout_used = 0;
+   timeout_free = UINT32_MAX;
 
    if (netdb == NULL) {
       netdb = netdb_open(top);
-      groups = xmalloc(sizeof(struct netgroup) * netdb_size(netdb));
+      const size_t ngroups = netdb_size(netdb);
+      if (posix_memalign((void **)&groups, GROUP_ALIGN,
+                         sizeof(struct netgroup) * MAX(ngroups, 1)) != 0)
+         fatal("failed to allocate memory for %zu signal groups", ngroups);
+      groups_cold = xmalloc(sizeof(struct netgroup_cold) * MAX(ngroups, 1));
+
+      // Static sensitivity list entries point back into this array so
+      // it is never resized
+      n_pending = 0;
+      pending_levels = 0;
+      unsigned nblocks;
+      do {
+         const unsigned shift = PENDING_SHIFT * (pending_levels + 1);
+         nblocks = (shift < 32) ? (netdb->nnets >> shift) + 1 : 1;
+         pending_base[pending_levels++] = n_pending;
+         n_pending += nblocks;
+      } while (nblocks > 1);
+      assert(pending_levels <= PENDING_LEVELS);
+
+      pending = xmalloc(sizeof(sens_list_t *) * n_pending);
+      memset(pending, '\0', sizeof(sens_list_t *) * n_pending);
    }
+   else
+      rt_free_pending();
 
    if (procs == NULL) {
       n_procs = tree_stmts(top);
@@ -1382,54 +2434,163 @@ static void rt_setup(tree_t top)
       procs[i].proc_fn    = jit_fun_ptr(istr(tree_ident(p)), true);
       procs[i].wakeup_gen = 0;
       procs[i].postponed  = tree_attr_int(p, postponed_i, 0);
+      procs[i].parallel   = tree_attr_int(p, parallel_i, 0);
+      procs[i].batched    = false;
+      procs[i].timeout    = NULL;
+      procs[i].sens_head   = NULL;
+      procs[i].sens_tail   = NULL;
+      procs[i].sens_cursor = NULL;
+      procs[i].comb_level  = 0;
+      procs[i].comb_queued = false;
+
+      rt_setup_clock(&(procs[i]));
+   }
+
+   const char *trace_fname = opt_get_str("rt-trace-file");
+   if ((trace_fname != NULL) && !trace_enabled()) {
+      trace_open(trace_fname, n_procs, rt_proc_name,
+                 netdb_size(netdb), rt_group_name);
+      btrace_on = true;
+   }
+
+   if ((profile == NULL) && (opt_get_str("rt-profile") != NULL)) {
+      profile = profile_new(n_procs, netdb_size(netdb));
+      for (size_t i = 0; i < n_procs; i++)
+         profile_set_source(profile, i, procs[i].source);
+   }
+}
+
+static void rt_clock_tick(rt_proc_t *proc)
+{
+   // Equivalent to running the generated code for the process but
+   // without the overhead of allocating the new value
+
+   TRACE("clock tick %s", istr(tree_ident(proc->source)));
+
+   active_proc = proc;
+
+   BTRACE(TRACE_RUN, proc - procs, TRACE_NONE, NULL, 0);
+
+   netgroup_t *g = proc->clock_group;
+   const uint8_t value = !*(uint8_t *)g->resolved;
+
+   if (proc->clock_kind == CLOCK_AFTER)
+      rt_sched_driver(g, proc->clock_period, proc->clock_reject, &value);
+   else {
+      rt_sched_driver(g, 0, 0, &value);
+
+      assert(proc->timeout == NULL);
+      proc->timeout = deltaq_insert_proc(proc->clock_period, proc);
    }
+
+   n_clock_ticks++;
 }
 
 static void rt_run(struct rt_proc *proc, bool reset)
 {
+   if ((proc->clock_group != NULL) && !reset) {
+      rt_clock_tick(proc);
+      return;
+   }
+
    TRACE("%s process %s", reset ? "reset" : "run",
          istr(tree_ident(proc->source)));
 
    if (reset) {
-      _tmp_stack = global_tmp_stack;
-      _tmp_alloc = global_tmp_alloc;
+      tmp_stack.base  = global_tmp_stack;
+      tmp_stack.alloc = global_tmp_alloc;
    }
    else {
-      _tmp_stack = proc_tmp_stack;
-      _tmp_alloc = 0;
+      tmp_stack.base  = proc_tmp_stack;
+      tmp_stack.alloc = 0;
    }
 
    active_proc = proc;
-   (*proc->proc_fn)(reset ? 1 : 0);
+
+   if (!reset)
+      BTRACE(TRACE_RUN, proc - procs, TRACE_NONE, NULL, 0);
+
+   if (unlikely(profile != NULL) && !reset) {
+      const uint64_t start = profile_ticks();
+      (*proc->proc_fn)(0);
+      profile_run(profile, proc - procs, profile_ticks() - start);
+   }
+   else
+      (*proc->proc_fn)(reset ? 1 : 0);
 
    if (reset)
-      global_tmp_alloc = _tmp_alloc;
+      global_tmp_alloc = tmp_stack.alloc;
 }
 
 static void rt_call_module_reset(ident_t name)
 {
    char *buf = xasprintf("%s_reset", istr(name));
 
-   _tmp_stack = global_tmp_stack;
-   _tmp_alloc = global_tmp_alloc;
+   tmp_stack.base  = global_tmp_stack;
+   tmp_stack.alloc = global_tmp_alloc;
 
    void (*reset_fn)(void) = jit_fun_ptr(buf, false);
    if (reset_fn != NULL)
       (*reset_fn)();
    free(buf);
 
-   global_tmp_alloc = _tmp_alloc;
+   global_tmp_alloc = tmp_stack.alloc;
+}
+
+static void rt_driver_inputs(netgroup_t *group, int driver,
+                             const void *values, const void **inputs)
+{
+   // Collect the current value of each driver substituting the new
+   // value for the driver being updated. Resolved groups are never
+   // packed so these can be passed straight to the resolution function.
+
+   assert(group->pack == 0);
+
+   for (int i = 0; i < group->n_drivers; i++) {
+      if (i == driver)
+         inputs[i] = values;
+      else
+         inputs[i] = rt_driver_value(group, i);
+   }
 }
 
 static int32_t rt_resolve_group(netgroup_t *group, int driver, void *values)
 {
-   // Set driver to -1 for initial call to resolution function
+   // Set driver to -1 for initial call to resolution function. The
+   // values are in the same format as the driver values.
 
    const size_t valuesz = group->size * group->length;
 
+   if ((group->pack != 0) && (driver == 0) && (group->resolution == NULL)
+       && !(group->flags & NET_F_FORCED)) {
+      // The resolved value is the unpacked value of the only driver so
+      // compare the packed values to detect an event
+      const size_t packedsz = rt_value_size(group);
+      const void *old = rt_driver_value(group, 0);
+      if (memcmp(old, values, packedsz) == 0)
+         return NET_F_ACTIVE;
+
+      if (group->flags & NET_F_LAST_VALUE)
+         memcpy(rt_cold(group)->last_value, old, packedsz);
+      rt_unpack_value(group, group->resolved, values, 0, group->length);
+
+      rt_cold(group)->last_event = now;
+      return NET_F_ACTIVE | NET_F_EVENT;
+   }
+
+   const int ndrivers = group->n_drivers;
+   const void *inputs[MAX(ndrivers, 1)];
+
+   if ((group->pack != 0) && !(group->flags & NET_F_FORCED)) {
+      // Only unresolved groups with a single driver are packed
+      uint8_t *unpacked = alloca(valuesz);
+      rt_unpack_value(group, unpacked, values, 0, group->length);
+      values = unpacked;
+   }
+
    void *resolved = NULL;
    if (unlikely(group->flags & NET_F_FORCED)) {
-      resolved = group->forcing->data;
+      resolved = rt_cold(group)->forcing->data;
    }
    else if (group->resolution == NULL) {
       resolved = values;
@@ -1443,49 +2604,59 @@ static int32_t rt_resolve_group(netgroup_t *group, int driver, void *values)
 
       resolved = alloca(valuesz);
 
-      for (int j = 0; j < group->length; j++) {
-         const int index = { ((const char *)values)[j] };
-         const int8_t r = group->resolution->tab1[index];
-         ((int8_t *)resolved)[j] = r;
-      }
+      simd_lookup1(resolved, values, group->length,
+                   group->resolution->tab1, group->resolution->nlits);
    }
    else if ((group->resolution->flags & R_MEMO) && (group->n_drivers == 2)) {
       // Resolution function has been memoised so do a table lookup
 
       resolved = alloca(valuesz);
 
-      const char *p0 = group->drivers[0].waveforms->values->data;
-      const char *p1 = group->drivers[1].waveforms->values->data;
+      rt_driver_inputs(group, driver, values, inputs);
 
-      for (int j = 0; j < group->length; j++) {
-         int driving[2] = { p0[j], p1[j] };
-         if (likely(driver >= 0))
-            driving[driver] = ((const char *)values)[j];
+      simd_lookup2(resolved, inputs[0], inputs[1], group->length,
+                   group->resolution->tab2, group->resolution->nlits);
+   }
+   else if (group->resolution->flags & R_FOLD) {
+      // Resolution function is equivalent to folding the memoised two
+      // value table over all the drivers
 
-         const int8_t r = group->resolution->tab2[driving[0]][driving[1]];
-         ((int8_t *)resolved)[j] = r;
-      }
-  }
+      resolved = alloca(valuesz);
+
+      const unsigned nlits = group->resolution->nlits;
+      const uint8_t *tab2  = group->resolution->tab2;
+
+      rt_driver_inputs(group, driver, values, inputs);
+
+      uint8_t *r = resolved;
+      memcpy(r, inputs[0], group->length);
+      for (int i = 1; i < ndrivers; i++)
+         simd_lookup2(r, r, inputs[i], group->length, tab2, nlits);
+   }
    else {
-      // Must actually call resolution function in general case
+      // Must actually call resolution function in general case. This
+      // is generated code which may report errors so only one thread
+      // can call it at a time.
 
       resolved = alloca(valuesz);
 
+      rt_driver_inputs(group, driver, values, inputs);
+
+      rt_serial_begin();
+
       for (int j = 0; j < group->length; j++) {
 #define CALL_RESOLUTION_FN(type) do {                                   \
-            type vals[group->n_drivers];                                \
-            for (int i = 0; i < group->n_drivers; i++) {                \
-               const value_t *v = group->drivers[i].waveforms->values;  \
-               vals[i] = ((const type *)v->data)[j];                    \
-            }                                                           \
-            if (likely(driver >= 0))                                    \
-               vals[driver] = ((const type *)values)[j];                \
+            type vals[ndrivers];                                        \
+            for (int i = 0; i < ndrivers; i++)                          \
+               vals[i] = ((const type *)inputs[i])[j];                  \
             type *r = (type *)resolved;                                 \
-            r[j] = (*group->resolution->fn)(vals, group->n_drivers);    \
+            r[j] = (*group->resolution->fn)(vals, ndrivers);            \
          } while (0)
 
          FOR_ALL_SIZES(group->size, CALL_RESOLUTION_FN);
       }
+
+      rt_serial_end();
    }
 
    int32_t new_flags = NET_F_ACTIVE;
@@ -1497,10 +2668,10 @@ static int32_t rt_resolve_group(netgroup_t *group, int driver, void *values)
    // only update it when there is an event
    if (new_flags & NET_F_EVENT) {
       if (group->flags & NET_F_LAST_VALUE)
-         memcpy(group->last_value, group->resolved, valuesz);
+         rt_write_value(group, rt_cold(group)->last_value, group->resolved);
       memcpy(group->resolved, resolved, valuesz);
 
-      group->last_event = now;
+      rt_cold(group)->last_event = now;
    }
 
    return new_flags;
@@ -1510,9 +2681,16 @@ static void rt_group_inital(groupid_t gid, netid_t first, unsigned length)
 {
    netgroup_t *g = &(groups[gid]);
    if ((g->n_drivers == 1) && (g->resolution == NULL))
-      rt_resolve_group(g, -1, g->drivers[0].waveforms->values->data);
-   else if (g->n_drivers > 0)
-      rt_resolve_group(g, -1, g->resolved);
+      rt_resolve_group(g, -1, rt_driver_value(g, 0));
+   else if (g->n_drivers > 0) {
+      uint8_t *values = g->resolved;
+      if (g->pack != 0) {
+         values = alloca(rt_value_size(g));
+         rt_pack_value(g, values, g->resolved);
+      }
+
+      rt_resolve_group(g, -1, values);
+   }
 }
 
 static void rt_initial(tree_t top)
@@ -1551,10 +2729,10 @@ static void rt_watch_signal(watch_t *w)
       netgroup_t *g = &(groups[netdb_lookup(netdb, nid)]);
 
       watch_list_t *link = xmalloc(sizeof(watch_list_t));
-      link->next  = g->watching;
+      link->next  = rt_cold(g)->watching;
       link->watch = w;
 
-      g->watching = link;
+      rt_cold(g)->watching = link;
 
       offset += g->length;
       (w->n_groups)++;
@@ -1583,11 +2761,28 @@ static void rt_wakeup(sens_list_t *sl)
    // generation: these correspond to stale "wait on" statements that
    // have already resumed.
 
+   // The entry has been removed from the pending list so cannot be
+   // reused by the process
+   if (sl->reenq == NULL)
+      rt_sens_unlink(sl);
+
    if ((sl->wakeup_gen == sl->proc->wakeup_gen) || (sl->reenq != NULL)) {
       TRACE("wakeup process %s%s", istr(tree_ident(sl->proc->source)),
             sl->proc->postponed ? " [postponed]" : "");
       ++(sl->proc->wakeup_gen);
 
+      BTRACE(TRACE_WAKEUP, sl->proc - procs, TRACE_NONE, NULL, 0);
+
+      if (unlikely(profile != NULL))
+         profile_wakeup(profile, sl->proc - procs, (sl->reenq != NULL)
+                        ? PROF_WAKE_STATIC : PROF_WAKE_DYNAMIC);
+
+      // Any timeout from the same wait statement is now stale
+      if (sl->proc->timeout != NULL) {
+         deltaq_cancel(sl->proc->timeout);
+         sl->proc->timeout = NULL;
+      }
+
       if (unlikely(sl->proc->postponed)) {
          sl->next  = postponed;
          postponed = sl;
@@ -1601,8 +2796,8 @@ static void rt_wakeup(sens_list_t *sl)
       rt_free(sens_list_stack, sl);
 }
 
-static bool rt_sched_driver(netgroup_t *group, uint64_t after,
-                            uint64_t reject, value_t *values)
+static void rt_sched_driver(netgroup_t *group, uint64_t after,
+                            uint64_t reject, const void *values)
 {
    if (unlikely(reject > after))
       fatal("signal %s pulse reject limit %s is greater than "
@@ -1610,68 +2805,126 @@ static bool rt_sched_driver(netgroup_t *group, uint64_t after,
 
    int driver = 0;
    if (unlikely(group->n_drivers != 1)) {
-      // Try to find this process in the list of existing drivers
-      for (driver = 0; driver < group->n_drivers; driver++) {
-         if (likely(group->drivers[driver].proc == active_proc))
-            break;
-      }
-
-      assert(driver != group->n_drivers);
+      driver = rt_find_driver(group, active_proc);
+      assert(driver != -1);
    }
 
    driver_t *d = &(group->drivers[driver]);
 
-   const size_t valuesz = group->size * group->length;
+   const size_t valuesz = rt_value_size(group);
 
-   waveform_t *w = rt_alloc(waveform_stack);
-   w->when   = now + after;
-   w->next   = NULL;
-   w->values = values;
-
-   waveform_t *last = d->waveforms;
-   waveform_t *it   = last->next;
-   while ((it != NULL) && (it->when < w->when)) {
-      // If the current transaction is within the pulse rejection interval
-      // and the value is different to that of the new transaction then
-      // delete the current transaction
-      if ((it->when >= w->when - reject)
-          && (memcmp(it->values->data, w->values->data, valuesz) != 0)) {
-         waveform_t *next = it->next;
-         last->next = next;
-         rt_free_value(group, it->values);
-         rt_free(waveform_stack, it);
-         it = next;
+   waveform_t w = {
+      .when  = now + after,
+      .next  = NULL,
+      .event = NULL
+   };
+   rt_set_wave_value(group, &w, values);
+
+   const void *new_value = rt_wave_value(group, &w);
+
+   BTRACE(TRACE_SCHED, active_proc - procs, group - groups,
+          new_value, valuesz);
+
+   // Number the transactions in time order across the ring and the
+   // spill list with the current value at position zero
+   unsigned n = d->count;
+   for (waveform_t *it = d->spill; it != NULL; it = it->next)
+      n++;
+
+   waveform_t *local[WAVE_RING_SIZE * 2];
+   waveform_t **slot = local;
+   if (unlikely(n > ARRAY_LEN(local)))
+      slot = xmalloc(sizeof(waveform_t *) * n);
+
+   for (unsigned i = 0; i < d->count; i++)
+      slot[i] = &(d->ring[(d->head + i) % WAVE_RING_SIZE]);
+   unsigned nslots = d->count;
+   for (waveform_t *it = d->spill; it != NULL; it = it->next)
+      slot[nslots++] = it;
+
+   // Earlier transactions are kept unless they are within the pulse
+   // rejection interval and have a different value to the new
+   // transaction. Survivors are compacted towards the front.
+   unsigned keep = 1, pos = 1;
+   for (; (pos < n) && (slot[pos]->when < w.when); pos++) {
+      waveform_t *it = slot[pos];
+      if ((it->when >= w.when - reject)
+          && (memcmp(rt_wave_value(group, it), new_value, valuesz) != 0)) {
+         deltaq_cancel(it->event);
+         rt_free_wave_value(group, it);
       }
       else {
-         last = it;
-         it = it->next;
+         if (keep != pos) {
+            slot[keep]->when  = it->when;
+            slot[keep]->event = it->event;
+            if (group->inline_values)
+               slot[keep]->inline_data = it->inline_data;
+            else
+               slot[keep]->values = it->values;
+         }
+         keep++;
       }
    }
-   w->next = NULL;
-   last->next = w;
 
-   // Delete all transactions later than this
-   // We could remove this transaction from the deltaq as well but the
-   // overhead of doing so is probably higher than the cost of waking
-   // up for the empty event
-   bool already_scheduled = false;
-   while (it != NULL) {
-      rt_free_value(group, it->values);
+   // Delete all transactions later than this and cancel their events
+   // unless one is at the same time as the new transaction in which
+   // case the event is reused
+   for (; pos < n; pos++) {
+      waveform_t *it = slot[pos];
+      rt_free_wave_value(group, it);
 
-      if (it->when == w->when)
-         already_scheduled = true;
+      if (it->when == w.when)
+         w.event = it->event;
+      else
+         deltaq_cancel(it->event);
+   }
 
-      waveform_t *next = it->next;
-      rt_free(waveform_stack, it);
-      it = next;
+   if (w.event != NULL)
+      ;
+   else if ((after == 0) && unlikely(comb_settling)
+            && rt_comb_internal(group))
+      w.event = &comb_event;   // Applied later in this cycle
+   else
+      w.event = deltaq_insert_driver(after, group, active_proc);
+
+   // Store the new transaction in the ring if there is space otherwise
+   // at the end of the spill list
+   waveform_t *dest;
+   if (keep < n)
+      dest = slot[keep];
+   else if (keep < WAVE_RING_SIZE)
+      dest = &(d->ring[(d->head + keep) % WAVE_RING_SIZE]);
+   else
+      dest = rt_alloc(waveform_stack);
+
+   *dest = w;
+
+   if (keep < WAVE_RING_SIZE) {
+      d->count = keep + 1;
+      for (unsigned i = WAVE_RING_SIZE; i < n; i++)
+         rt_free(waveform_stack, slot[i]);
+      d->spill = NULL;
+   }
+   else {
+      d->count = WAVE_RING_SIZE;
+      for (unsigned i = keep + 1; i < n; i++)
+         rt_free(waveform_stack, slot[i]);
+      if (keep == WAVE_RING_SIZE)
+         d->spill = dest;
+      else
+         slot[keep - 1]->next = dest;
    }
 
-   return already_scheduled;
+   if (slot != local)
+      free(slot);
 }
 
-static void rt_update_group(netgroup_t *group, int driver, void *values)
+static int32_t rt_update_group(netgroup_t *group, int driver, void *values)
 {
-   const size_t valuesz = group->size * group->length;
+   // Only touches state owned by this group so may be called for
+   // different groups in parallel
+
+   const size_t valuesz = rt_value_size(group);
 
    TRACE("update group %s values=%s driver=%d",
          fmt_group(group), fmt_values(values, valuesz), driver);
@@ -1679,6 +2932,13 @@ static void rt_update_group(netgroup_t *group, int driver, void *values)
    const int32_t new_flags = rt_resolve_group(group, driver, values);
    group->flags |= new_flags;
 
+   BTRACE(TRACE_UPDATE, TRACE_NONE, group - groups, group->resolved,
+          group->length * group->size);
+   return new_flags;
+}
+
+static void rt_notify_group(netgroup_t *group, int32_t new_flags)
+{
    if (unlikely(n_active_groups == n_active_alloc)) {
       n_active_alloc *= 2;
       const size_t newsz = n_active_alloc * sizeof(struct netgroup *);
@@ -1691,38 +2951,58 @@ static void rt_update_group(netgroup_t *group, int driver, void *values)
       sens_list_t *it, *last = NULL, *next = NULL;
 
       // First wakeup everything on the group specific pending list
+      // except processes waiting for a different edge of a scalar
+      // signal which stay on the list
+      const unsigned value = *(const uint8_t *)group->resolved;
       for (it = group->pending; it != NULL; it = next) {
          next = it->next;
-         rt_wakeup(it);
-         group->pending = next;
-      }
 
-      // Now check the global pending list
-      if (group->flags & NET_F_GLOBAL) {
-         for (it = pending; it != NULL; it = next) {
-            next = it->next;
-
-            const netid_t x = group->first;
-            const netid_t y = group->first + group->length - 1;
-            const netid_t a = it->first;
-            const netid_t b = it->last;
-
-            const bool hit = (x <= b) && (a <= y);
-
-            if (hit) {
-               rt_wakeup(it);
-               if (last == NULL)
-                  pending = next;
-               else
-                  last->next = next;
+         if (unlikely(it->edge_mask != 0)
+             && ((value >= SCHED_EDGE_LITS)
+                 || !(it->edge_mask & (1 << value)))) {
+            last = it;
+            n_filtered++;
+            continue;
+         }
+
+         if (last == NULL)
+            group->pending = next;
+         else
+            last->next = next;
+         rt_wakeup(it);
+      }
+
+      // Now check the global pending list for each block of nets
+      // covered by this group
+      if (group->flags & NET_F_GLOBAL) {
+         const netid_t x = group->first;
+         const netid_t y = group->first + group->length - 1;
+
+         for (unsigned level = 0; level < pending_levels; level++) {
+            const unsigned lo = rt_pending_block(level, x);
+            const unsigned hi = rt_pending_block(level, y);
+            for (unsigned blk = lo; blk <= hi; blk++) {
+               last = NULL;
+               for (it = pending[blk]; it != NULL; it = next) {
+                  next = it->next;
+
+                  if ((x <= it->last) && (it->first <= y)) {
+                     if (last == NULL)
+                        pending[blk] = next;
+                     else
+                        last->next = next;
+                     rt_wakeup(it);
+                  }
+                  else
+                     last = it;
+               }
             }
-            else
-               last = it;
          }
       }
 
       // Schedule any callbacks to run
-      for (watch_list_t *wl = group->watching; wl != NULL; wl = wl->next) {
+      watch_list_t *wl = rt_cold(group)->watching;
+      for (; wl != NULL; wl = wl->next) {
          if (!wl->watch->pending) {
             wl->watch->chain_pending = callbacks;
             wl->watch->pending = true;
@@ -1732,36 +3012,79 @@ static void rt_update_group(netgroup_t *group, int driver, void *values)
    }
 }
 
-static void rt_update_driver(netgroup_t *group, rt_proc_t *proc)
+static int32_t rt_apply_group(netgroup_t *group, bool force,
+                              retired_t *retired)
 {
-   if (likely(proc != NULL)) {
-      // Find the driver owned by proc
-      int driver;
-      for (driver = 0; driver < group->n_drivers; driver++) {
-         if (likely(group->drivers[driver].proc == proc))
-            break;
+   // Update the group with the current transaction from every driver
+   // that has one and return the new group flags. The drivers are
+   // applied together so the group is resolved at most once per cycle.
+   // Old values are passed back through retired for the caller to free.
+
+   retired->values = NULL;
+   retired->spill  = NULL;
+
+   int driver = -1, nupdated = 0;
+   for (int i = 0; i < group->n_drivers; i++) {
+      const waveform_t *w_next = rt_driver_next(&(group->drivers[i]));
+      if ((w_next != NULL) && (w_next->when == now)) {
+         driver = i;
+         nupdated++;
       }
-      assert(driver != group->n_drivers);
+   }
+
+   const bool forced = !!(group->flags & NET_F_FORCED);
 
-      waveform_t *w_now  = group->drivers[driver].waveforms;
-      waveform_t *w_next = w_now->next;
+   int32_t new_flags = 0;
+   if (unlikely(forced && (force || (nupdated > 0))))
+      new_flags = rt_update_group(group, -1, rt_cold(group)->forcing->data);
+   else if (nupdated == 1) {
+      waveform_t *w_next = rt_driver_next(&(group->drivers[driver]));
+      new_flags = rt_update_group(group, driver,
+                                  rt_wave_value(group, w_next));
+   }
 
-      if (likely((w_next != NULL) && (w_next->when == now))) {
-         rt_update_group(group, driver, w_next->values->data);
-         group->drivers[driver].waveforms = w_next;
-         rt_free_value(group, w_now->values);
-         rt_free(waveform_stack, w_now);
+   for (int i = 0; (i < group->n_drivers) && (nupdated > 0); i++) {
+      driver_t *d = &(group->drivers[i]);
+      waveform_t *w_next = rt_driver_next(d);
+
+      if ((w_next != NULL) && (w_next->when == now)) {
+         w_next->event = NULL;
+         rt_driver_advance(group, d, retired);
       }
-      else
-         assert(w_now != NULL);
    }
-   else if (group->flags & NET_F_FORCED)
-      rt_update_group(group, -1, group->forcing->data);
+
+   if ((nupdated > 1) && !forced) {
+      // Every driver now holds its new value
+      new_flags = rt_update_group(group, -1, rt_driver_value(group, 0));
+   }
+
+   return new_flags;
+}
+
+static void rt_update_driver(netgroup_t *group, bool force)
+{
+   if (unlikely(profile != NULL))
+      profile_group_event(profile, group - groups);
+
+   if (group->flags & NET_F_ACTIVE) {
+      // An earlier event this cycle already applied every transaction
+      n_coalesced++;
+      return;
+   }
+
+   retired_t retired;
+   const int32_t new_flags = rt_apply_group(group, force, &retired);
+
+   if (new_flags != 0)
+      rt_notify_group(group, new_flags);
+
+   rt_free_retired(group, &retired);
 }
 
 static bool rt_stale_event(event_t *e)
 {
-   return (e->kind == E_PROCESS) && (e->wakeup_gen != e->proc->wakeup_gen);
+   return (e->kind == E_PROCESS)
+      && (e->wakeup_gen != rt_event_proc(e)->wakeup_gen);
 }
 
 static void rt_push_run_queue(event_t *e)
@@ -1781,9 +3104,17 @@ static void rt_push_run_queue(event_t *e)
    if (unlikely(rt_stale_event(e)))
       rt_free(event_stack, e);
    else {
+      n_events++;
       run_queue.queue[(run_queue.wr)++] = e;
-      if (e->kind == E_PROCESS)
-         ++(e->proc->wakeup_gen);
+      if (e->kind == E_PROCESS) {
+         rt_proc_t *proc = rt_event_proc(e);
+         ++(proc->wakeup_gen);
+         if (proc->timeout == e)
+            proc->timeout = NULL;
+
+         if (unlikely(profile != NULL))
+            profile_wakeup(profile, e->index, PROF_WAKE_TIMEOUT);
+      }
    }
 }
 
@@ -1798,6 +3129,395 @@ static event_t *rt_pop_run_queue(void)
       return run_queue.queue[(run_queue.rd)++];
 }
 
+static void rt_replay_trap(const stage_trap_t *r)
+{
+   // Call the original runtime function again to raise the error
+
+   const int32_t *args = r->args;
+   switch (r->trap) {
+   case TRAP_BOUNDS:
+      _bounds_fail(args[0], r->module, args[1], args[2], args[3],
+                   args[4], args[5]);
+      break;
+   case TRAP_DIV_ZERO:
+      _div_zero(args[0], r->module);
+      break;
+   case TRAP_NULL_DEREF:
+      _null_deref(args[0], r->module);
+      break;
+   case TRAP_VALUE_ATTR:
+      _value_attr((const uint8_t *)(r + 1), args[0], args[1], r->module);
+      break;
+   case TRAP_BIT_VEC:
+      // Fails the length check before touching either argument
+      _bit_vec_op(BIT_VEC_AND, NULL, args[0], RANGE_TO,
+                  NULL, args[1], RANGE_TO, NULL);
+      break;
+   }
+
+   fatal_trace("replayed trap %d did not fail", r->trap);
+}
+
+static void rt_replay(const stage_t *stage)
+{
+   const uint8_t *p = stage->buf;
+   const uint8_t *end = p + stage->used;
+   while (p < end) {
+      const stage_hdr_t *hdr = (const stage_hdr_t *)p;
+      switch (hdr->kind) {
+      case STAGE_PROCESS:
+         {
+            const stage_process_t *r = (const stage_process_t *)hdr;
+            _sched_process(r->delay);
+         }
+         break;
+
+      case STAGE_WAVEFORM:
+         {
+            const stage_waveform_t *r = (const stage_waveform_t *)hdr;
+            int32_t *nids = (int32_t *)(r + 1);
+            _sched_waveform(nids, nids + r->n, r->n, r->after, r->reject);
+         }
+         break;
+
+      case STAGE_EVENT:
+         {
+            const stage_event_t *r = (const stage_event_t *)hdr;
+            _sched_event((int32_t *)(r + 1), r->n, r->flags);
+         }
+         break;
+
+      case STAGE_ASSERT:
+         {
+            const stage_assert_t *r = (const stage_assert_t *)hdr;
+            _assert_fail((const uint8_t *)(r + 1), r->msg_len, r->severity,
+                         r->where, r->module);
+         }
+         break;
+
+      case STAGE_TRAP:
+         rt_replay_trap((const stage_trap_t *)hdr);
+         break;
+      }
+
+      p += hdr->length;
+   }
+}
+
+static void rt_resume_done(sens_list_t *sl)
+{
+   if (sl->reenq == NULL)
+      rt_free(sens_list_stack, sl);
+   else {
+      sl->next = *(sl->reenq);
+      *(sl->reenq) = sl;
+   }
+}
+
+static void rt_batch_run_slot(batch_slot_t *slot)
+{
+   jmp_buf env;
+
+   slot->stage.used = 0;
+   active_stage = &(slot->stage);
+
+   if (setjmp(env) == 0) {
+      trap_jmp = &env;
+      rt_run(slot->proc, false /* reset */);
+   }
+
+   active_stage = NULL;
+   trap_jmp = NULL;
+}
+
+static void rt_batch_work(unsigned id)
+{
+   for (;;) {
+      const unsigned next =
+         __atomic_fetch_add(&batch_next, 1, __ATOMIC_RELAXED);
+      if (next >= batch_len)
+         break;
+
+      rt_batch_run_slot(&(batch[next]));
+   }
+}
+
+static void *rt_worker_thread(void *arg)
+{
+   const unsigned id = (uintptr_t)arg;
+
+   proc_tmp_stack = mmap_guarded(PROC_TMP_STACK_SZ, "process temp stack");
+
+   // Resolution functions may allocate from the temporary stack
+   tmp_stack.base  = proc_tmp_stack;
+   tmp_stack.alloc = 0;
+
+   unsigned gen = 0;
+   for (;;) {
+      // Spin for a while before sleeping as another batch of processes
+      // usually follows shortly
+      int spins = POOL_SPIN_LIMIT;
+      while ((__atomic_load_n(&pool_gen, __ATOMIC_ACQUIRE) == gen)
+             && (--spins > 0))
+         ;
+
+      if (spins == 0) {
+         pthread_mutex_lock(&pool_lock);
+         while (__atomic_load_n(&pool_gen, __ATOMIC_ACQUIRE) == gen)
+            pthread_cond_wait(&pool_cond, &pool_lock);
+         pthread_mutex_unlock(&pool_lock);
+      }
+
+      gen = __atomic_load_n(&pool_gen, __ATOMIC_ACQUIRE);
+
+      if (pool_quit)
+         break;
+
+      in_pool = true;
+      (*pool_fn)(id);
+      in_pool = false;
+
+      __atomic_sub_fetch(&pool_busy, 1, __ATOMIC_RELEASE);
+   }
+
+   return NULL;
+}
+
+static void rt_pool_start(void)
+{
+   if (n_threads <= 1)
+      return;
+
+   workers = xmalloc((n_threads - 1) * sizeof(pthread_t));
+   for (unsigned i = 0; i < n_threads - 1; i++) {
+      void *id = (void *)(uintptr_t)(i + 1);
+      if (pthread_create(&(workers[i]), NULL, rt_worker_thread, id) != 0)
+         fatal_errno("pthread_create");
+   }
+}
+
+static void rt_pool_run(pool_fn_t fn)
+{
+   // Call fn on every thread in the pool and wait for them all to
+   // return. The main thread has ID zero.
+
+   pool_fn   = fn;
+   pool_busy = n_threads - 1;
+
+   pthread_mutex_lock(&pool_lock);
+   __atomic_add_fetch(&pool_gen, 1, __ATOMIC_RELEASE);
+   pthread_cond_broadcast(&pool_cond);
+   pthread_mutex_unlock(&pool_lock);
+
+   in_pool = true;
+   (*fn)(0);
+   in_pool = false;
+
+   while (__atomic_load_n(&pool_busy, __ATOMIC_ACQUIRE) > 0)
+      sched_yield();
+}
+
+static void rt_pool_stop(void)
+{
+   if (workers == NULL)
+      return;
+
+   pthread_mutex_lock(&pool_lock);
+   pool_quit = true;
+   __atomic_add_fetch(&pool_gen, 1, __ATOMIC_RELEASE);
+   pthread_cond_broadcast(&pool_cond);
+   pthread_mutex_unlock(&pool_lock);
+
+   for (unsigned i = 0; i < n_threads - 1; i++)
+      pthread_join(workers[i], NULL);
+
+   free(workers);
+   workers = NULL;
+
+   for (unsigned i = 0; i < batch_alloc; i++)
+      free(batch[i].stage.buf);
+
+   free(batch);
+   batch = NULL;
+   batch_alloc = 0;
+
+   for (unsigned i = 0; i < update_alloc; i++)
+      free(update_stages[i].buf);
+
+   free(update_flags);
+   free(update_retired);
+   free(update_stages);
+   update_flags   = NULL;
+   update_retired = NULL;
+   update_stages  = NULL;
+   update_alloc   = 0;
+}
+
+static void rt_batch_flush(void)
+{
+   // Run a batch of processes that may execute concurrently and then
+   // apply their side effects in the order they were added
+
+   if (batch_len == 0)
+      return;
+   else if (batch_len < MIN_PARALLEL_BATCH) {
+      // Not worth waking up the worker threads
+      for (unsigned i = 0; i < batch_len; i++) {
+         rt_run(batch[i].proc, false /* reset */);
+         batch[i].proc->batched = false;
+         if (batch[i].wakeup != NULL)
+            rt_resume_done(batch[i].wakeup);
+      }
+   }
+   else {
+      batch_next = 0;
+      rt_pool_run(rt_batch_work);
+
+      for (unsigned i = 0; i < batch_len; i++) {
+         active_proc = batch[i].proc;
+         rt_replay(&(batch[i].stage));
+         batch[i].proc->batched = false;
+         if (batch[i].wakeup != NULL)
+            rt_resume_done(batch[i].wakeup);
+      }
+
+      n_batches++;
+      n_batched += batch_len;
+   }
+
+   batch_len = 0;
+}
+
+static void rt_batch_add(rt_proc_t *proc, sens_list_t *wakeup)
+{
+   // A process can only appear once in each batch
+   if (proc->batched)
+      rt_batch_flush();
+
+   if (unlikely(batch_len == batch_alloc)) {
+      const unsigned old_alloc = batch_alloc;
+      batch_alloc = MAX(batch_alloc * 2, 64);
+      batch = xrealloc(batch, batch_alloc * sizeof(batch_slot_t));
+      memset(&(batch[old_alloc]), '\0',
+             (batch_alloc - old_alloc) * sizeof(batch_slot_t));
+   }
+
+   batch_slot_t *slot = &(batch[batch_len++]);
+   slot->proc   = proc;
+   slot->wakeup = wakeup;
+
+   proc->batched = true;
+}
+
+static inline bool rt_can_batch(rt_proc_t *proc)
+{
+   return (n_threads > 1) && proc->parallel;
+}
+
+static void rt_update_slot(unsigned i, netgroup_t *g)
+{
+   // Resolution functions may report or fail so their side effects are
+   // staged and replayed in run queue order like a batch of processes
+
+   jmp_buf env;
+
+   update_flags[i] = 0;
+   update_retired[i].values = NULL;
+   update_retired[i].spill  = NULL;
+
+   update_stages[i].used = 0;
+   active_stage = &(update_stages[i]);
+
+   if (setjmp(env) == 0) {
+      trap_jmp = &env;
+      update_flags[i] = rt_apply_group(g, update_events[i]->force,
+                                       &(update_retired[i]));
+   }
+
+   active_stage = NULL;
+   trap_jmp = NULL;
+}
+
+static void rt_update_work(unsigned id)
+{
+   // Each group is owned by a single thread so only the first event
+   // for a group applies its transactions and later ones are coalesced
+
+   for (unsigned i = 0; i < update_len; i++) {
+      netgroup_t *g = rt_event_group(update_events[i]);
+      if ((g - groups) % n_threads != id)
+         continue;
+      else if (g->flags & NET_F_ACTIVE) {
+         update_flags[i] = 0;
+         update_retired[i].values = NULL;
+         update_retired[i].spill  = NULL;
+         update_stages[i].used = 0;
+      }
+      else
+         rt_update_slot(i, g);
+   }
+}
+
+static void rt_update_drivers(event_t *first)
+{
+   // Apply first and any immediately following driver events in the
+   // run queue. Groups are resolved in parallel and then processes are
+   // woken and callbacks scheduled in run queue order on this thread.
+
+   assert(run_queue.queue[run_queue.rd - 1] == first);
+
+   size_t end = run_queue.rd;
+   while ((end < run_queue.wr) && (run_queue.queue[end]->kind == E_DRIVER))
+      end++;
+
+   update_events = &(run_queue.queue[run_queue.rd - 1]);
+   update_len    = end - run_queue.rd + 1;
+
+   run_queue.rd = end;
+
+   if (update_len < MIN_PARALLEL_UPDATE) {
+      for (unsigned i = 0; i < update_len; i++)
+         rt_update_driver(rt_event_group(update_events[i]),
+                          update_events[i]->force);
+   }
+   else {
+      if (unlikely(update_len > update_alloc)) {
+         const unsigned old_alloc = update_alloc;
+         update_alloc   = MAX(update_len, update_alloc * 2);
+         update_flags   = xrealloc(update_flags,
+                                   update_alloc * sizeof(int32_t));
+         update_retired = xrealloc(update_retired,
+                                   update_alloc * sizeof(retired_t));
+         update_stages  = xrealloc(update_stages,
+                                   update_alloc * sizeof(stage_t));
+         memset(&(update_stages[old_alloc]), '\0',
+                (update_alloc - old_alloc) * sizeof(stage_t));
+      }
+
+      rt_pool_run(rt_update_work);
+
+      for (unsigned i = 0; i < update_len; i++) {
+         netgroup_t *g = rt_event_group(update_events[i]);
+         rt_replay(&(update_stages[i]));
+         if (update_flags[i] != 0)
+            rt_notify_group(g, update_flags[i]);
+         else if (g->flags & NET_F_ACTIVE)
+            n_coalesced++;
+
+         rt_free_retired(g, &(update_retired[i]));
+      }
+
+      n_update_batches++;
+      n_updated += update_len;
+   }
+
+   // The caller frees the first event
+   for (unsigned i = 1; i < update_len; i++)
+      rt_free(event_stack, update_events[i]);
+
+   update_len = 0;
+}
+
 static void rt_iteration_limit(void)
 {
    text_buf_t *buf = tb_new();
@@ -1821,20 +3541,21 @@ static void rt_resume_processes(sens_list_t **list)
 {
    sens_list_t *it = *list;
    while (it != NULL) {
-      rt_run(it->proc, false /* reset */);
-
       sens_list_t *next = it->next;
 
-      if (it->reenq == NULL)
-         rt_free(sens_list_stack, it);
+      if (rt_can_batch(it->proc))
+         rt_batch_add(it->proc, it);
       else {
-         it->next = *(it->reenq);
-         *(it->reenq) = it;
+         rt_batch_flush();
+         rt_run(it->proc, false /* reset */);
+         rt_resume_done(it);
       }
 
       it = next;
    }
 
+   rt_batch_flush();
+
    *list = NULL;
 }
 
@@ -1856,29 +3577,409 @@ static void rt_event_callback(bool postponed)
    }
 }
 
-static inline bool rt_next_cycle_is_delta(void)
+////////////////////////////////////////////////////////////////////////////////
+// Levelised combinational evaluation
+
+// With --levelise the combinational processes tagged by opt are ordered
+// by their depth in the network of single driver signals between them.
+// Woken processes run in that order after all other processes in the
+// cycle. A transaction on a signal read only by processes at a deeper
+// level is applied straight away so a chain of gates settles in one
+// delta cycle rather than one per gate. Other signals, including those
+// read by any other kind of process, still change in the next delta.
+// Readers are found from the references in each process whether or not
+// it is sensitive to the signal.
+
+#define COMB_UNKNOWN_READER UINT32_MAX
+
+typedef struct {
+   uint32_t proc;
+   uint32_t next;
+} comb_reader_t;
+
+typedef struct {
+   hash_t        *map;
+   comb_reader_t *readers;
+   uint32_t       nreaders;
+   uint32_t       max_readers;
+   uint32_t       proc;
+} comb_read_ctx_t;
+
+static void rt_comb_read_fn(tree_t t, void *context)
+{
+   comb_read_ctx_t *ctx = context;
+
+   // Follow aliases back to the signal they name
+   tree_t decl = tree_ref(t);
+   while (tree_kind(decl) == T_ALIAS) {
+      tree_t value = tree_value(decl);
+      tree_kind_t kind;
+      while ((kind = tree_kind(value)) != T_REF) {
+         if ((kind != T_ARRAY_REF) && (kind != T_ARRAY_SLICE)
+             && (kind != T_RECORD_REF))
+            return;
+         value = tree_value(value);
+      }
+      decl = tree_ref(value);
+   }
+
+   if (tree_kind(decl) != T_SIGNAL_DECL)
+      return;
+
+   // Each process is visited in one go so only the most recent reader
+   // needs to be checked for duplicates
+   const uint32_t head = (uintptr_t)hash_get(ctx->map, decl);
+   if ((head != 0) && (ctx->readers[head - 1].proc == ctx->proc))
+      return;
+
+   if (ctx->nreaders == ctx->max_readers) {
+      ctx->max_readers = MAX(ctx->max_readers * 2, 256);
+      ctx->readers = xrealloc(ctx->readers,
+                              ctx->max_readers * sizeof(comb_reader_t));
+   }
+
+   ctx->readers[ctx->nreaders].proc = ctx->proc;
+   ctx->readers[ctx->nreaders].next = head;
+   hash_put(ctx->map, decl, (void *)(uintptr_t)++(ctx->nreaders));
+}
+
+static void rt_comb_mark_groups(tree_t top)
+{
+   // Flag each group whose every reader is a levelised process deeper
+   // than its driver
+
+   comb_read_ctx_t ctx = {
+      .map = hash_new(1024, true)
+   };
+
+   for (size_t i = 0; i < n_procs; i++) {
+      ctx.proc = i;
+      tree_visit_only(procs[i].source, rt_comb_read_fn, &ctx, T_REF);
+   }
+
+   // Subprograms outside processes may read signals directly
+   ctx.proc = COMB_UNKNOWN_READER;
+   const int ndecls = tree_decls(top);
+   for (int i = 0; i < ndecls; i++) {
+      tree_t d = tree_decl(top, i);
+      const tree_kind_t kind = tree_kind(d);
+      if ((kind == T_FUNC_BODY) || (kind == T_PROC_BODY))
+         tree_visit_only(d, rt_comb_read_fn, &ctx, T_REF);
+   }
+
+   const size_t ngroups = netdb_size(netdb);
+   for (size_t i = 0; i < ngroups; i++) {
+      netgroup_t *g = &(groups[i]);
+      g->flags &= ~NET_F_COMB;
+
+      if ((g->n_drivers != 1) || (g->flags & NET_F_GLOBAL)
+          || (g->drivers[0].proc == NULL))
+         continue;
+
+      const rt_proc_t *driver = g->drivers[0].proc;
+      if ((driver->comb_level == 0) || (rt_cold(g)->sig_decl == NULL))
+         continue;
+
+      bool internal = true;
+      uint32_t it = (uintptr_t)hash_get(ctx.map, rt_cold(g)->sig_decl);
+      for (; internal && (it != 0); it = ctx.readers[it - 1].next) {
+         const uint32_t reader = ctx.readers[it - 1].proc;
+         if (reader == COMB_UNKNOWN_READER)
+            internal = false;
+         else if (reader != driver - procs)
+            internal = (procs[reader].comb_level > driver->comb_level);
+      }
+
+      if (internal)
+         g->flags |= NET_F_COMB;
+   }
+
+   hash_free(ctx.map);
+   free(ctx.readers);
+}
+
+static bool rt_comb_candidate(const netgroup_t *g, const bool *comb)
+{
+   return (g->n_drivers == 1) && !(g->flags & NET_F_GLOBAL)
+      && (g->drivers[0].proc != NULL) && comb[g->drivers[0].proc - procs];
+}
+
+static void rt_levelise(tree_t top)
+{
+   // Processes that read no signal driven by another combinational
+   // process are at level one. Those in or downstream of a loop are
+   // left at level zero and evaluated with delta cycles as usual.
+
+   bool *comb = xmalloc(sizeof(bool) * MAX(n_procs, 1));
+   for (size_t i = 0; i < n_procs; i++)
+      comb[i] = tree_attr_int(procs[i].source, comb_i, 0)
+         && !procs[i].postponed && (procs[i].clock_group == NULL);
+
+   typedef struct { uint32_t from, to; } edge_t;
+   edge_t *edges = NULL;
+   size_t nedges = 0, max_edges = 0;
+
+   const size_t ngroups = netdb_size(netdb);
+   for (size_t i = 0; i < ngroups; i++) {
+      netgroup_t *g = &(groups[i]);
+      if (!rt_comb_candidate(g, comb))
+         continue;
+
+      const uint32_t from = g->drivers[0].proc - procs;
+      for (sens_list_t *it = g->pending; it != NULL; it = it->next) {
+         if ((it->reenq == NULL) || !comb[it->proc - procs])
+            continue;
+
+         if (nedges == max_edges) {
+            max_edges = MAX(max_edges * 2, 64);
+            edges = xrealloc(edges, max_edges * sizeof(edge_t));
+         }
+
+         edges[nedges].from = from;
+         edges[nedges].to   = it->proc - procs;
+         nedges++;
+      }
+   }
+
+   // Index the edges by source process
+   uint32_t *first = xmalloc(sizeof(uint32_t) * (n_procs + 1));
+   uint32_t *succ  = xmalloc(sizeof(uint32_t) * MAX(nedges, 1));
+   uint32_t *indeg = xmalloc(sizeof(uint32_t) * MAX(n_procs, 1));
+   memset(first, '\0', sizeof(uint32_t) * (n_procs + 1));
+   memset(indeg, '\0', sizeof(uint32_t) * MAX(n_procs, 1));
+
+   for (size_t i = 0; i < nedges; i++) {
+      first[edges[i].from + 1]++;
+      indeg[edges[i].to]++;
+   }
+   for (size_t i = 0; i < n_procs; i++)
+      first[i + 1] += first[i];
+
+   uint32_t *fill = xmalloc(sizeof(uint32_t) * MAX(n_procs, 1));
+   memcpy(fill, first, sizeof(uint32_t) * n_procs);
+   for (size_t i = 0; i < nedges; i++)
+      succ[fill[edges[i].from]++] = edges[i].to;
+
+   // Topological sort where each process is one level deeper than the
+   // deepest process driving one of its inputs
+   uint32_t *queue = fill;
+   size_t qhead = 0, qtail = 0;
+   for (size_t i = 0; i < n_procs; i++) {
+      if (comb[i] && (indeg[i] == 0)) {
+         procs[i].comb_level = 1;
+         queue[qtail++] = i;
+      }
+   }
+
+   comb_levels = 0;
+   while (qhead < qtail) {
+      rt_proc_t *p = &(procs[queue[qhead++]]);
+      comb_levels = MAX(comb_levels, p->comb_level);
+
+      for (uint32_t j = first[p - procs]; j < first[p - procs + 1]; j++) {
+         rt_proc_t *q = &(procs[succ[j]]);
+         q->comb_level = MAX(q->comb_level, p->comb_level + 1);
+         if (--indeg[succ[j]] == 0)
+            queue[qtail++] = succ[j];
+      }
+   }
+
+   n_comb_procs = n_comb_loops = 0;
+   for (size_t i = 0; i < n_procs; i++) {
+      if (!comb[i])
+         continue;
+      else if (indeg[i] > 0) {
+         procs[i].comb_level = 0;
+         n_comb_loops++;
+      }
+      else {
+         // Staged assignments would be applied after the cycle
+         procs[i].parallel = false;
+         n_comb_procs++;
+      }
+   }
+
+   TRACE("levelised %u processes into %u levels; %u in loops",
+         n_comb_procs, comb_levels, n_comb_loops);
+
+   free(comb_ready);
+   comb_ready = xmalloc(sizeof(sens_list_t *) * (comb_levels + 1));
+   memset(comb_ready, '\0', sizeof(sens_list_t *) * (comb_levels + 1));
+   comb_lo = UINT_MAX;
+   comb_hi = 0;
+
+   free(comb);
+   free(edges);
+   free(first);
+   free(succ);
+   free(indeg);
+   free(fill);
+
+   rt_comb_mark_groups(top);
+}
+
+static bool rt_comb_internal(netgroup_t *group)
+{
+   // No process can see that a transaction on a signal with a single
+   // driver read only by levelised processes deeper than the driver
+   // was applied in this cycle rather than the next
+
+   if ((active_proc->comb_level == 0) || !(group->flags & NET_F_COMB))
+      return false;
+   else if (group->flags & (NET_F_ACTIVE | NET_F_FORCED))
+      return false;
+
+   if (n_comb_groups == n_comb_alloc) {
+      n_comb_alloc = MAX(n_comb_alloc * 2, 16);
+      comb_groups = xrealloc(comb_groups, n_comb_alloc * sizeof(netgroup_t *));
+   }
+   comb_groups[n_comb_groups++] = group;
+
+   return true;
+}
+
+static void rt_comb_split(sens_list_t **list)
+{
+   // Move levelised processes to the list for their level so each runs
+   // once however many of its inputs changed
+
+   sens_list_t **last = list, *it, *next;
+   for (it = *list; it != NULL; it = next) {
+      next = it->next;
+
+      rt_proc_t *proc = it->proc;
+      if (proc->comb_level == 0) {
+         last = &(it->next);
+         continue;
+      }
+
+      *last = next;
+
+      if (proc->comb_queued)
+         rt_resume_done(it);
+      else {
+         const unsigned level = proc->comb_level;
+         it->next = comb_ready[level];
+         comb_ready[level] = it;
+         proc->comb_queued = true;
+
+         comb_lo = MIN(comb_lo, level);
+         comb_hi = MAX(comb_hi, level);
+      }
+   }
+}
+
+static void rt_comb_settle(void)
+{
+   comb_settling = true;
+
+   while (comb_lo <= comb_hi) {
+      sens_list_t *list = comb_ready[comb_lo];
+      comb_ready[comb_lo++] = NULL;
+
+      for (sens_list_t *it = list; it != NULL; it = it->next)
+         it->proc->comb_queued = false;
+
+      rt_resume_processes(&list);
+
+      if (n_comb_groups > 0) {
+         // Each level that changes an internal signal would otherwise
+         // have needed another delta cycle
+         for (unsigned i = 0; i < n_comb_groups; i++)
+            rt_update_driver(comb_groups[i], false);
+         n_comb_groups = 0;
+         n_comb_saved++;
+
+         rt_comb_split(&resume);
+      }
+   }
+
+   comb_lo = UINT_MAX;
+   comb_hi = 0;
+   comb_settling = false;
+
+   // Callbacks for the internal signals must run at this time step
+   rt_resume_processes(&resume);
+   if (callbacks != NULL)
+      rt_event_callback(false);
+}
+
+static inline bool rt_next_cycle_is_delta(void)
+{
+   return !deltaq_empty();
+}
+
+static uint64_t rt_wall_ns(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (uint64_t)ts.tv_sec * UINT64_C(1000000000) + ts.tv_nsec;
+}
+
+static void rt_heartbeat(void)
 {
-   return (delta_driver != NULL) || (delta_proc != NULL);
+   // Called every cycle when a heartbeat interval is set and after
+   // SIGUSR1 is received so the rates cover the time since the last
+   // heartbeat rather than the whole run. Reading the monotonic clock
+   // is a cheap vDSO call whereas a fixed number of slow cycles could
+   // take minutes.
+
+   const uint64_t wall = rt_wall_ns();
+   if (!heartbeat_signal && (wall < heartbeat_next))
+      return;
+
+   heartbeat_signal = 0;
+   if (heartbeat_ns > 0)
+      heartbeat_next = wall + heartbeat_ns;
+
+   const double secs = (wall - heartbeat_last.ns) / 1e9;
+   const double sim_rate = (now - heartbeat_last.now) / MAX(secs, 1e-9);
+
+   struct rusage ru;
+   getrusage(RUSAGE_SELF, &ru);
+
+   FILE *f = (heartbeat_file != NULL) ? heartbeat_file : stderr;
+   fprintf(f, "heartbeat: time:%s+%d wall:%.1fs sim/wall:%s/s "
+           "events:%"PRIu64" (%.0f/s) deltas:%"PRIu64" (%.0f/s) "
+           "queue:%zu peak events:%zu waveforms:%zu maxrss:%ldkB\n",
+           fmt_time(now), iteration, (wall - ready_ns) / 1e9,
+           fmt_time((uint64_t)sim_rate), n_events,
+           (n_events - heartbeat_last.events) / MAX(secs, 1e-9), n_deltas,
+           (n_deltas - heartbeat_last.deltas) / MAX(secs, 1e-9),
+           eventq_size(), rt_alloc_stack_hwm(event_stack),
+           rt_alloc_stack_hwm(waveform_stack), ru.ru_maxrss);
+   fflush(f);
+
+   heartbeat_last.ns     = wall;
+   heartbeat_last.now    = now;
+   heartbeat_last.events = n_events;
+   heartbeat_last.deltas = n_deltas;
 }
 
 static void rt_cycle(int stop_delta)
 {
    // Simulation cycle is described in LRM 93 section 12.6.4
 
-   const bool is_delta_cycle = (delta_driver != NULL) || (delta_proc != NULL);
+   const bool is_delta_cycle = !deltaq_empty();
 
-   if (is_delta_cycle)
+   if (is_delta_cycle) {
       iteration = iteration + 1;
+      n_deltas++;
+   }
    else {
-      event_t *peek = heap_min(eventq_heap);
+      event_t *peek = eventq_min();
       while (unlikely(rt_stale_event(peek))) {
          // Discard stale events
-         rt_free(event_stack, heap_extract_min(eventq_heap));
-         if (heap_size(eventq_heap) == 0)
+         rt_free(event_stack, eventq_extract_min());
+         if (eventq_size() == 0)
             return;
          else
-            peek = heap_min(eventq_heap);
+            peek = eventq_min();
       }
+
+      if (unlikely(profile != NULL) && (iteration >= 0))
+         profile_time_step(profile, iteration + 1);
+
       now = peek->when;
       iteration = 0;
    }
@@ -1895,25 +3996,27 @@ static void rt_cycle(int stop_delta)
 #endif
 
    if (is_delta_cycle) {
-      for (event_t *e = delta_driver; e != NULL; e = e->delta_chain)
-         rt_push_run_queue(e);
+      // Events are pushed newest first to preserve the order in which
+      // processes have always been run within a delta cycle
+      for (size_t i = delta_driver.count; i > 0; i--)
+         rt_push_run_queue(delta_driver.queue[i - 1]);
 
-      for (event_t *e = delta_proc; e != NULL; e = e->delta_chain)
-         rt_push_run_queue(e);
+      for (size_t i = delta_proc.count; i > 0; i--)
+         rt_push_run_queue(delta_proc.queue[i - 1]);
 
-      delta_driver = NULL;
-      delta_proc = NULL;
+      delta_driver.count = 0;
+      delta_proc.count = 0;
    }
    else {
       rt_global_event(RT_NEXT_TIME_STEP);
 
       for (;;) {
-         rt_push_run_queue(heap_extract_min(eventq_heap));
+         rt_push_run_queue(eventq_extract_min());
 
-         if (heap_size(eventq_heap) == 0)
+         if (eventq_size() == 0)
             break;
 
-         event_t *peek = heap_min(eventq_heap);
+         event_t *peek = eventq_min();
          if (peek->when > now)
             break;
       }
@@ -1923,20 +4026,33 @@ static void rt_cycle(int stop_delta)
    while ((event = rt_pop_run_queue())) {
       switch (event->kind) {
       case E_PROCESS:
-         rt_run(event->proc, false /* reset */);
+         if (rt_can_batch(rt_event_proc(event)))
+            rt_batch_add(rt_event_proc(event), NULL);
+         else {
+            rt_batch_flush();
+            rt_run(rt_event_proc(event), false /* reset */);
+         }
          break;
       case E_DRIVER:
-         rt_update_driver(event->group, event->proc);
+         rt_batch_flush();
+         if (n_threads > 1)
+            rt_update_drivers(event);
+         else
+            rt_update_driver(rt_event_group(event), event->force);
          break;
       case E_TIMEOUT:
-         (*event->timeout_fn)(now, event->timeout_user);
+         rt_batch_flush();
+         rt_timeout_run(event);
          break;
       }
 
       rt_free(event_stack, event);
    }
 
-   if (unlikely(now == 0 && iteration == 0)) {
+   rt_batch_flush();
+
+   if (unlikely((now == 0 && iteration == 0) || wave_restart)) {
+      wave_restart = false;
       vcd_restart();
       lxt_restart();
       fst_restart();
@@ -1948,7 +4064,11 @@ static void rt_cycle(int stop_delta)
    rt_event_callback(false);
 
    // Run all processes that resumed because of signal events
+   if (comb_levels > 0)
+      rt_comb_split(&resume);
    rt_resume_processes(&resume);
+   if (comb_lo <= comb_hi)
+      rt_comb_settle();
    rt_global_event(RT_END_OF_PROCESSES);
 
    for (unsigned i = 0; i < n_active_groups; i++) {
@@ -1968,7 +4088,16 @@ static void rt_cycle(int stop_delta)
       rt_event_callback(true);
 
       can_create_delta = true;
+
+      // Periodically give back driver value memory no longer needed
+      if (++trim_steps == SLAB_TRIM_STEPS) {
+         rt_slab_trim();
+         trim_steps = 0;
+      }
    }
+
+   if (unlikely(heartbeat_signal) || (heartbeat_ns > 0))
+      rt_heartbeat();
 }
 
 static void rt_load_unit(const char *name)
@@ -2016,6 +4145,7 @@ static tree_t rt_recall_tree(const char *unit, int32_t where)
 static void rt_cleanup_group(groupid_t gid, netid_t first, unsigned length)
 {
    netgroup_t *g = &(groups[gid]);
+   netgroup_cold_t *cold = &(groups_cold[gid]);
 
    assert(g->first == first);
    assert(g->length == length);
@@ -2023,23 +4153,22 @@ static void rt_cleanup_group(groupid_t gid, netid_t first, unsigned length)
    if (g->flags & NET_F_OWNS_MEM)
       free(g->resolved);
 
-   free(g->forcing);
+   free(cold->forcing);
 
    for (int j = 0; j < g->n_drivers; j++) {
-      while (g->drivers[j].waveforms != NULL) {
-         waveform_t *next = g->drivers[j].waveforms->next;
-         rt_free_value(g, g->drivers[j].waveforms->values);
-         rt_free(waveform_stack, g->drivers[j].waveforms);
-         g->drivers[j].waveforms = next;
+      driver_t *d = &(g->drivers[j]);
+      for (int i = 0; i < d->count; i++)
+         rt_free_wave_value(g, &(d->ring[(d->head + i) % WAVE_RING_SIZE]));
+
+      while (d->spill != NULL) {
+         waveform_t *next = d->spill->next;
+         rt_free_wave_value(g, d->spill);
+         rt_free(waveform_stack, d->spill);
+         d->spill = next;
       }
    }
    free(g->drivers);
-
-   while (g->free_values != NULL) {
-      value_t *next = g->free_values->next;
-      free(g->free_values);
-      g->free_values = next;
-   }
+   free(cold->driver_map);
 
    while (g->pending != NULL) {
       sens_list_t *next = g->pending->next;
@@ -2047,10 +4176,10 @@ static void rt_cleanup_group(groupid_t gid, netid_t first, unsigned length)
       g->pending = next;
    }
 
-   while (g->watching != NULL) {
-      watch_list_t *next = g->watching->next;
-      free(g->watching);
-      g->watching = next;
+   while (cold->watching != NULL) {
+      watch_list_t *next = cold->watching->next;
+      free(cold->watching);
+      cold->watching = next;
    }
 }
 
@@ -2058,14 +4187,18 @@ static void rt_cleanup(tree_t top)
 {
    assert(resume == NULL);
 
-   while (heap_size(eventq_heap) > 0)
-      rt_free(event_stack, heap_extract_min(eventq_heap));
+   while (eventq_size() > 0)
+      rt_free(event_stack, eventq_extract_min());
 
-   rt_free_delta_events(delta_proc);
-   rt_free_delta_events(delta_driver);
+   rt_free_delta_events(&delta_proc);
+   rt_free_delta_events(&delta_driver);
 
-   heap_free(eventq_heap);
-   eventq_heap = NULL;
+   eventq_free();
+
+   free(timeout_cbs);
+   timeout_cbs   = NULL;
+   timeout_alloc = timeout_used = 0;
+   timeout_free  = UINT32_MAX;
 
    netdb_walk(netdb, rt_cleanup_group);
    netdb_close(netdb);
@@ -2077,11 +4210,12 @@ static void rt_cleanup(tree_t top)
       watches = next;
    }
 
-   while (pending != NULL) {
-      sens_list_t *next = pending->next;
-      rt_free(sens_list_stack, pending);
-      pending = next;
-   }
+   rt_free_pending();
+
+   free(pending);
+   pending = NULL;
+   n_pending = 0;
+   pending_levels = 0;
 
    for (int i = 0; i < RT_LAST_EVENT; i++) {
       while (global_cbs[i] != NULL) {
@@ -2091,6 +4225,8 @@ static void rt_cleanup(tree_t top)
       }
    }
 
+   event_peak = rt_alloc_stack_hwm(event_stack);
+
    rt_alloc_stack_destroy(event_stack);
    rt_alloc_stack_destroy(waveform_stack);
    rt_alloc_stack_destroy(sens_list_stack);
@@ -2102,16 +4238,16 @@ static void rt_cleanup(tree_t top)
 
 static bool rt_stop_now(uint64_t stop_time)
 {
-   if ((delta_driver != NULL) || (delta_proc != NULL))
+   if (!deltaq_empty())
       return false;
-   else if (heap_size(eventq_heap) == 0)
+   else if (eventq_size() == 0)
       return true;
    else if (force_stop)
       return true;
    else if (stop_time == UINT64_MAX)
       return false;
    else {
-      event_t *peek = heap_min(eventq_heap);
+      event_t *peek = eventq_min();
       return peek->when > stop_time;
    }
 }
@@ -2122,6 +4258,26 @@ static void rt_stats_print(void)
    nvc_rusage(&ru);
 
    notef("setup:%ums run:%ums maxrss:%ukB", ready_rusage.ms, ru.ms, ru.rss);
+   notef("events cancelled:%"PRIu64" coalesced:%"PRIu64" vector kernels:%s",
+         n_cancelled, n_coalesced, simd_level_str(simd_level));
+   notef("events peak:%zu size:%zu bytes memory:%zukB", event_peak,
+         sizeof(event_t), (event_peak * sizeof(event_t) + 1023) / 1024);
+   notef("wakeups skipped by edge filter:%"PRIu64" native clock ticks:%"
+         PRIu64, n_filtered, n_clock_ticks);
+
+   if (n_threads > 1) {
+      notef("threads:%u parallel batches:%"PRIu64" processes:%"PRIu64,
+            n_threads, n_batches, n_batched);
+      notef("parallel updates:%"PRIu64" transactions:%"PRIu64,
+            n_update_batches, n_updated);
+   }
+
+   if (levelise)
+      notef("levelised processes:%u levels:%u in loops:%u delta cycles "
+            "avoided:%"PRIu64, n_comb_procs, comb_levels, n_comb_loops,
+            n_comb_saved);
+
+   rt_slab_stats();
 }
 
 static void rt_reset_coverage(tree_t top)
@@ -2157,11 +4313,542 @@ static void rt_interrupt(void)
       fatal("interrupted");
 }
 
+static void rt_heartbeat_request(int sig)
+{
+   heartbeat_signal = 1;
+}
+
+static void rt_cache_stats_open(void)
+{
+   // Count last level cache misses on the simulation thread using the
+   // hardware performance counters
+
+#ifdef HAVE_LINUX_PERF_EVENT_H
+   struct perf_event_attr attr;
+   memset(&attr, '\0', sizeof(attr));
+   attr.type           = PERF_TYPE_HARDWARE;
+   attr.size           = sizeof(attr);
+   attr.config         = PERF_COUNT_HW_CACHE_MISSES;
+   attr.exclude_kernel = 1;
+   attr.exclude_hv     = 1;
+
+   cache_fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+   if (cache_fd < 0)
+      warnf("cannot count cache misses: %s", strerror(errno));
+#else
+   warnf("cache miss counting is not supported on this platform");
+#endif
+}
+
+static void rt_cache_stats_close(void)
+{
+   if (cache_fd < 0)
+      return;
+
+   close(cache_fd);
+   cache_fd = -1;
+
+   const double mean =
+      (cache_cycles > 0) ? (double)cache_misses / cache_cycles : 0.0;
+
+   notef("cache misses:%"PRIu64" cycles:%"PRIu64" per cycle mean:%.1f "
+         "max:%"PRIu64, cache_misses, cache_cycles, mean, cache_max);
+}
+
+static uint64_t rt_read_cache_misses(void)
+{
+   uint64_t value;
+   if (read(cache_fd, &value, sizeof(value)) != sizeof(value))
+      fatal_errno("reading cache miss counter");
+   return value;
+}
+
+static void rt_cycle_cache_stats(int stop_delta)
+{
+   const uint64_t before = rt_read_cache_misses();
+   rt_cycle(stop_delta);
+   const uint64_t misses = rt_read_cache_misses() - before;
+
+   cache_misses += misses;
+   cache_max = MAX(cache_max, misses);
+   cache_cycles++;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Simulation checkpoints
+
+// A checkpoint is taken between two time steps when the delta queues,
+// run queue, and resume lists are all empty. It is restored on top of
+// a design that has just been reset so anything the reset functions
+// rebuild such as drivers, resolution functions, and the global
+// temporary stack is not saved.
+
+#define CKPT_MAGIC   0x4b43564e   // NVCK
+#define CKPT_VERSION 3
+
+typedef enum {
+   CKPT_LIST_GROUP,
+   CKPT_LIST_BLOCK
+} ckpt_list_t;
+
+// Leading fields of the process state struct built by cgen_state_type
+typedef struct {
+   int32_t  state;
+   void    *pcall;
+} proc_state_hdr_t;
+
+// Entry in the table of process states built by cgen_state_table
+typedef struct {
+   proc_state_hdr_t *state;
+   uint64_t          size;
+   uint8_t           flat;
+} proc_state_entry_t;
+
+static const proc_state_entry_t *rt_proc_states(void)
+{
+   // One entry for each process in the same order as procs
+
+   char *name LOCAL = xasprintf("%s__state_table", istr(top_name));
+   return jit_var_ptr(name, true);
+}
+
+static void rt_ckpt_write_str(const char *str, fbuf_t *f)
+{
+   const size_t len = strlen(str);
+   write_u32(len, f);
+   write_raw(str, len, f);
+}
+
+static char *rt_ckpt_read_str(fbuf_t *f)
+{
+   const uint32_t len = read_u32(f);
+   char *str = xmalloc(len + 1);
+   read_raw(str, len, f);
+   str[len] = '\0';
+   return str;
+}
+
+static uint32_t rt_ckpt_event_id(hash_t *ids, event_t *e)
+{
+   if (e == NULL)
+      return UINT32_MAX;
+
+   void *id = hash_get(ids, e);
+   assert(id != NULL);
+   return (uintptr_t)id - 1;
+}
+
+static void rt_ckpt_write_list(sens_list_t *list, ckpt_list_t kind,
+                               unsigned index, fbuf_t *f)
+{
+   unsigned count = 0;
+   for (sens_list_t *it = list; it != NULL; it = it->next)
+      count++;
+
+   write_u8(kind, f);
+   write_u32(index, f);
+   write_u32(count, f);
+
+   for (sens_list_t *it = list; it != NULL; it = it->next) {
+      write_u32(it->proc - procs, f);
+      write_u32(it->wakeup_gen, f);
+      write_u32(it->first, f);
+      write_u32(it->last, f);
+      write_u16(it->edge_mask, f);
+      write_u8(it->reenq != NULL, f);
+   }
+}
+
+static void rt_checkpoint(const char *fname)
+{
+   assert(deltaq_empty());
+   assert(resume == NULL);
+   assert(postponed == NULL);
+
+   fbuf_t *f = fbuf_open(fname, FBUF_OUT);
+   if (f == NULL)
+      fatal_errno("failed to create %s", fname);
+
+   const size_t ngroups = netdb_size(netdb);
+
+   write_u32(CKPT_MAGIC, f);
+   write_u32(CKPT_VERSION, f);
+   rt_ckpt_write_str(istr(top_name), f);
+   write_u32(n_procs, f);
+   write_u32(ngroups, f);
+   write_u64(now, f);
+   write_u32(iteration, f);
+
+   // Take every future event out of the queue to number them and then
+   // put them back in the same order
+   const size_t nevents = eventq_size();
+   event_t **events = xmalloc(sizeof(event_t *) * MAX(nevents, 1));
+   hash_t *ids = hash_new(nevents * 2 + 16, true);
+
+   uint32_t nlive = 0;
+   for (size_t i = 0; i < nevents; i++) {
+      event_t *e = events[i] = eventq_extract_min();
+      if (e->kind == E_TIMEOUT)
+         warnf("timeout callback at %s is not saved in checkpoint",
+               fmt_time(e->when));
+      else if (!rt_stale_event(e))
+         hash_put(ids, e, (void *)(uintptr_t)++nlive);
+   }
+
+   write_u32(nlive, f);
+   for (size_t i = 0; i < nevents; i++) {
+      event_t *e = events[i];
+      if ((e->kind != E_TIMEOUT) && !rt_stale_event(e)) {
+         write_u64(e->when, f);
+         write_u8(e->kind, f);
+         write_u32(e->index, f);
+         write_u32(e->wakeup_gen, f);
+         write_u8(e->force, f);
+      }
+
+      deltaq_insert(e);
+   }
+
+   free(events);
+
+   const proc_state_entry_t *states = rt_proc_states();
+   for (size_t i = 0; i < n_procs; i++) {
+      rt_proc_t *p = &(procs[i]);
+
+      const char *name = istr(tree_ident(p->source));
+
+      const proc_state_entry_t *s = &(states[i]);
+      if (!s->flat)
+         fatal_at(tree_loc(p->source), "cannot checkpoint process %s as "
+                  "its variables contain pointers", name);
+      else if (s->state->pcall != NULL)
+         fatal_at(tree_loc(p->source), "cannot checkpoint process %s while "
+                  "it is waiting in a procedure", name);
+
+      write_u32(p->wakeup_gen, f);
+      write_u32(rt_ckpt_event_id(ids, p->timeout), f);
+      write_u64(s->size, f);
+      write_raw(s->state, s->size, f);
+   }
+
+   for (groupid_t gid = 0; gid < ngroups; gid++) {
+      netgroup_t *g = &(groups[gid]);
+      netgroup_cold_t *cold = &(groups_cold[gid]);
+
+      const size_t fullsz  = g->size * g->length;
+      const size_t valuesz = rt_value_size(g);
+
+      write_u32(g->flags & ~(NET_F_ACTIVE | NET_F_EVENT), f);
+      write_u32(fullsz, f);
+      if (g->resolved != NULL)
+         write_raw(g->resolved, fullsz, f);
+      if (cold->last_value != NULL)
+         write_raw(cold->last_value, valuesz, f);
+      write_u64(cold->last_event, f);
+      if (g->flags & NET_F_FORCED)
+         write_raw(cold->forcing->data, fullsz, f);
+
+      write_u16(g->n_drivers, f);
+      for (int i = 0; i < g->n_drivers; i++) {
+         driver_t *d = &(g->drivers[i]);
+
+         unsigned n = d->count;
+         for (waveform_t *it = d->spill; it != NULL; it = it->next)
+            n++;
+         write_u32(n, f);
+
+         // The event for the current value has already run
+         waveform_t *w = rt_driver_now(d);
+         for (unsigned j = 0; j < n; j++) {
+            write_u64(w->when, f);
+            write_u32((j == 0) ? UINT32_MAX
+                      : rt_ckpt_event_id(ids, w->event), f);
+            write_raw(rt_wave_value(g, w), valuesz, f);
+
+            if (j + 1 < d->count)
+               w = &(d->ring[(d->head + j + 1) % WAVE_RING_SIZE]);
+            else if (j + 1 == d->count)
+               w = d->spill;
+            else
+               w = w->next;
+         }
+      }
+   }
+
+   unsigned nlists = 0;
+   for (groupid_t gid = 0; gid < ngroups; gid++)
+      nlists += (groups[gid].pending != NULL);
+   for (unsigned b = 0; b < n_pending; b++)
+      nlists += (pending[b] != NULL);
+
+   write_u32(nlists, f);
+   for (groupid_t gid = 0; gid < ngroups; gid++) {
+      if (groups[gid].pending != NULL)
+         rt_ckpt_write_list(groups[gid].pending, CKPT_LIST_GROUP, gid, f);
+   }
+   for (unsigned b = 0; b < n_pending; b++) {
+      if (pending[b] != NULL)
+         rt_ckpt_write_list(pending[b], CKPT_LIST_BLOCK, b, f);
+   }
+
+   fbuf_close(f);
+   hash_free(ids);
+
+   notef("checkpoint at %s written to %s", fmt_time(now), fname);
+}
+
+static void rt_restore_corrupt(const char *fname)
+{
+   fatal("%s: checkpoint does not match this design", fname);
+}
+
+static event_t *rt_restore_event(event_t **events, uint32_t nevents,
+                                 uint32_t id, const char *fname)
+{
+   if (id == UINT32_MAX)
+      return NULL;
+   else if (id >= nevents)
+      rt_restore_corrupt(fname);
+
+   return events[id];
+}
+
+static void rt_restore_driver(netgroup_t *g, driver_t *d, event_t **events,
+                              uint32_t nevents, fbuf_t *f, const char *fname)
+{
+   // Release the initial value set by the reset function
+
+   for (int i = 0; i < d->count; i++)
+      rt_free_wave_value(g, &(d->ring[(d->head + i) % WAVE_RING_SIZE]));
+
+   while (d->spill != NULL) {
+      waveform_t *next = d->spill->next;
+      rt_free_wave_value(g, d->spill);
+      rt_free(waveform_stack, d->spill);
+      d->spill = next;
+   }
+
+   const uint32_t n = read_u32(f);
+   if (n == 0)
+      rt_restore_corrupt(fname);
+
+   const size_t valuesz = rt_value_size(g);
+
+   d->head  = 0;
+   d->count = 0;
+
+   waveform_t *tail = NULL;
+   for (unsigned j = 0; j < n; j++) {
+      waveform_t *w;
+      if (j < WAVE_RING_SIZE) {
+         w = &(d->ring[j]);
+         d->count++;
+      }
+      else {
+         w = rt_alloc(waveform_stack);
+         if (tail == NULL)
+            d->spill = w;
+         else
+            tail->next = w;
+         tail = w;
+      }
+
+      w->when  = read_u64(f);
+      w->event = rt_restore_event(events, nevents, read_u32(f), fname);
+      w->next  = NULL;
+
+      // Saved values are already packed
+      if (g->inline_values) {
+         w->inline_data = 0;
+         read_raw(&(w->inline_data), valuesz, f);
+      }
+      else {
+         w->values = rt_alloc_value(g);
+         read_raw(w->values->data, valuesz, f);
+      }
+   }
+}
+
+static void rt_restore_list(sens_list_t **list, fbuf_t *f, const char *fname)
+{
+   // Entries are saved head first so append to preserve the order
+
+   assert(*list == NULL);
+
+   sens_list_t **tail = list;
+
+   const uint32_t count = read_u32(f);
+   for (unsigned i = 0; i < count; i++) {
+      const uint32_t index = read_u32(f);
+      if (index >= n_procs)
+         rt_restore_corrupt(fname);
+
+      sens_list_t *node = rt_alloc(sens_list_stack);
+      node->proc       = &(procs[index]);
+      node->wakeup_gen = read_u32(f);
+      node->first      = read_u32(f);
+      node->last       = read_u32(f);
+      node->edge_mask  = read_u16(f);
+      node->next       = NULL;
+      node->list       = list;
+      node->reenq      = read_u8(f) ? list : NULL;
+
+      if (node->reenq == NULL)
+         rt_sens_link(node->proc, node);
+
+      *tail = node;
+      tail = &(node->next);
+   }
+}
+
+void rt_set_checkpoint(uint64_t when, const char *fname)
+{
+   free(checkpoint_fname);
+   checkpoint_at    = when;
+   checkpoint_fname = strdup(fname);
+}
+
+void rt_restore(tree_t top, const char *fname)
+{
+   fbuf_t *f = fbuf_open(fname, FBUF_IN);
+   if (f == NULL)
+      fatal_errno("failed to open %s", fname);
+
+   if (read_u32(f) != CKPT_MAGIC)
+      fatal("%s: not a checkpoint file", fname);
+
+   const uint32_t version = read_u32(f);
+   if (version != CKPT_VERSION)
+      fatal("%s: unsupported checkpoint version %u", fname, version);
+
+   const size_t ngroups = netdb_size(netdb);
+
+   char *name LOCAL = rt_ckpt_read_str(f);
+   if (strcmp(name, istr(tree_ident(top))) != 0)
+      rt_restore_corrupt(fname);
+   else if ((read_u32(f) != n_procs) || (read_u32(f) != ngroups))
+      rt_restore_corrupt(fname);
+
+   now       = read_u64(f);
+   iteration = (int32_t)read_u32(f);
+
+   // Discard everything scheduled by the reset functions
+
+   rt_free_delta_events(&delta_proc);
+   rt_free_delta_events(&delta_driver);
+
+   while (eventq_size() > 0) {
+      event_t *e = eventq_extract_min();
+      if (e->kind == E_TIMEOUT)
+         warnf("timeout callback at %s discarded by restore",
+               fmt_time(e->when));
+      rt_free(event_stack, e);
+   }
+
+   rt_free_pending();
+
+   const uint32_t nevents = read_u32(f);
+   event_t **events = xmalloc(sizeof(event_t *) * MAX(nevents, 1));
+   for (unsigned i = 0; i < nevents; i++) {
+      event_t *e = events[i] = rt_alloc(event_stack);
+      e->when       = read_u64(f);
+      e->kind       = read_u8(f);
+      e->index      = read_u32(f);
+      e->wakeup_gen = read_u32(f);
+      e->force      = read_u8(f);
+
+      const bool is_proc = (e->kind == E_PROCESS);
+      if ((e->when <= now) || (!is_proc && (e->kind != E_DRIVER))
+          || (e->index >= (is_proc ? n_procs : ngroups)))
+         rt_restore_corrupt(fname);
+   }
+
+   const proc_state_entry_t *states = rt_proc_states();
+   for (size_t i = 0; i < n_procs; i++) {
+      rt_proc_t *p = &(procs[i]);
+
+      p->wakeup_gen  = read_u32(f);
+      p->timeout     = rt_restore_event(events, nevents, read_u32(f), fname);
+      p->sens_head   = NULL;
+      p->sens_tail   = NULL;
+      p->sens_cursor = NULL;
+
+      const proc_state_entry_t *s = &(states[i]);
+      if (!s->flat || (read_u64(f) != s->size))
+         rt_restore_corrupt(fname);
+
+      read_raw(s->state, s->size, f);
+   }
+
+   for (groupid_t gid = 0; gid < ngroups; gid++) {
+      netgroup_t *g = &(groups[gid]);
+      netgroup_cold_t *cold = &(groups_cold[gid]);
+
+      const size_t fullsz = g->size * g->length;
+
+      const net_flags_t flags = read_u32(f);
+      if (read_u32(f) != fullsz)
+         rt_restore_corrupt(fname);
+
+      const net_flags_t keep = NET_F_OWNS_MEM | NET_F_COMB;
+      g->flags = (flags & ~keep) | (g->flags & keep);
+
+      if (g->resolved != NULL)
+         read_raw(g->resolved, fullsz, f);
+      if (cold->last_value != NULL)
+         read_raw(cold->last_value, rt_value_size(g), f);
+      cold->last_event = read_u64(f);
+
+      if (flags & NET_F_FORCED) {
+         if (cold->forcing == NULL)
+            cold->forcing = xmalloc(sizeof(struct value) + fullsz);
+         read_raw(cold->forcing->data, fullsz, f);
+      }
+
+      if (read_u16(f) != g->n_drivers)
+         rt_restore_corrupt(fname);
+
+      for (int i = 0; i < g->n_drivers; i++)
+         rt_restore_driver(g, &(g->drivers[i]), events, nevents, f, fname);
+
+      while (g->pending != NULL) {
+         sens_list_t *next = g->pending->next;
+         rt_free(sens_list_stack, g->pending);
+         g->pending = next;
+      }
+   }
+
+   const uint32_t nlists = read_u32(f);
+   for (unsigned i = 0; i < nlists; i++) {
+      const ckpt_list_t kind = read_u8(f);
+      const uint32_t index = read_u32(f);
+
+      if ((kind == CKPT_LIST_GROUP) && (index < ngroups))
+         rt_restore_list(&(groups[index].pending), f, fname);
+      else if ((kind == CKPT_LIST_BLOCK) && (index < n_pending))
+         rt_restore_list(&(pending[index]), f, fname);
+      else
+         rt_restore_corrupt(fname);
+   }
+
+   for (unsigned i = 0; i < nevents; i++)
+      deltaq_insert(events[i]);
+
+   free(events);
+   fbuf_close(f);
+
+   heartbeat_last.now = now;
+   wave_restart = true;
+
+   notef("restored checkpoint at %s from %s", fmt_time(now), fname);
+}
+
 void rt_start_of_tool(tree_t top, tree_rd_ctx_t ctx)
 {
    tree_rd_ctx = ctx;
+   top_name    = tree_ident(top);
 
-   jit_init(tree_ident(top));
+   jit_init(top_name);
 
    struct sigaction sa;
    sa.sa_sigaction = (void*)rt_interrupt;
@@ -2170,6 +4857,13 @@ void rt_start_of_tool(tree_t top, tree_rd_ctx_t ctx)
 
    sigaction(SIGINT, &sa, NULL);
 
+   struct sigaction sa_usr1;
+   sa_usr1.sa_handler = rt_heartbeat_request;
+   sigemptyset(&sa_usr1.sa_mask);
+   sa_usr1.sa_flags = SA_RESTART;
+
+   sigaction(SIGUSR1, &sa_usr1, NULL);
+
    jit_bind_fn("_std_standard_now", _std_standard_now);
    jit_bind_fn("_sched_process", _sched_process);
    jit_bind_fn("_sched_waveform", _sched_waveform);
@@ -2192,7 +4886,25 @@ void rt_start_of_tool(tree_t top, tree_rd_ctx_t ctx)
    jit_bind_fn("_div_zero", _div_zero);
    jit_bind_fn("_null_deref", _null_deref);
 
-   trace_on = opt_get_int("rt_trace_en");
+   trace_on  = opt_get_int("rt_trace_en");
+   use_wheel = opt_get_int("rt-wheel");
+   pack_signals = opt_get_int("rt-pack");
+   levelise = opt_get_int("rt-levelise");
+   n_threads = opt_get_int("rt-threads");
+   simd_level = simd_init();
+
+   rt_alloc_huge_pages(opt_get_int("rt-huge-pages"));
+
+   if (n_threads == 0)
+      n_threads = MAX(sysconf(_SC_NPROCESSORS_ONLN), 1);
+
+   // Tracing, coverage, and profile counters are not thread safe
+   if (trace_on || (jit_var_ptr("cover_stmts", false) != NULL)
+       || (opt_get_str("rt-profile") != NULL))
+      n_threads = 1;
+
+   if (opt_get_int("rt-perf-map"))
+      jit_write_perf_map();
 
    event_stack     = rt_alloc_stack_new(sizeof(event_t), "event");
    waveform_stack  = rt_alloc_stack_new(sizeof(waveform_t), "waveform");
@@ -2209,12 +4921,54 @@ void rt_start_of_tool(tree_t top, tree_rd_ctx_t ctx)
    global_tmp_alloc = 0;
 
    rt_reset_coverage(top);
+   rt_pool_start();
+
+   if (opt_get_int("rt-cache-stats"))
+      rt_cache_stats_open();
 
    nvc_rusage(&ready_rusage);
+
+   ready_ns = rt_wall_ns();
+
+   heartbeat_ns = opt_get_int("rt-heartbeat") * UINT64_C(1000000000);
+   heartbeat_next = ready_ns + heartbeat_ns;
+   heartbeat_last.ns = ready_ns;
+
+   const char *hb_fname = opt_get_str("rt-heartbeat-file");
+   if ((hb_fname != NULL) && ((heartbeat_file = fopen(hb_fname, "w")) == NULL))
+      fatal_errno("failed to open %s", hb_fname);
 }
 
 void rt_end_of_tool(tree_t top)
 {
+   rt_cache_stats_close();
+   rt_pool_stop();
+
+   if (heartbeat_file != NULL) {
+      fclose(heartbeat_file);
+      heartbeat_file = NULL;
+   }
+
+   if (checkpoint_fname != NULL) {
+      warnf("simulation stopped before checkpoint time %s",
+            fmt_time(checkpoint_at));
+      free(checkpoint_fname);
+      checkpoint_fname = NULL;
+   }
+
+   if (btrace_on) {
+      trace_close();
+      btrace_on = false;
+   }
+
+   if (profile != NULL) {
+      if (iteration >= 0)
+         profile_time_step(profile, iteration + 1);
+
+      profile_report(profile, opt_get_str("rt-profile"), rt_group_name);
+      profile_free(profile);
+      profile = NULL;
+   }
    rt_cleanup(top);
    rt_emit_coverage(top);
 
@@ -2222,6 +4976,8 @@ void rt_end_of_tool(tree_t top)
 
    if (opt_get_int("rt-stats"))
       rt_stats_print();
+
+   rt_slab_destroy();
 }
 
 void rt_run_sim(uint64_t stop_time)
@@ -2229,8 +4985,19 @@ void rt_run_sim(uint64_t stop_time)
    const int stop_delta = opt_get_int("stop-delta");
 
    rt_global_event(RT_START_OF_SIMULATION);
-   while (!rt_stop_now(stop_time))
-      rt_cycle(stop_delta);
+   while (!rt_stop_now(stop_time)) {
+      if (unlikely(checkpoint_fname != NULL) && deltaq_empty()
+          && (eventq_min()->when >= checkpoint_at)) {
+         rt_checkpoint(checkpoint_fname);
+         free(checkpoint_fname);
+         checkpoint_fname = NULL;
+      }
+
+      if (unlikely(cache_fd >= 0))
+         rt_cycle_cache_stats(stop_delta);
+      else
+         rt_cycle(stop_delta);
+   }
    rt_global_event(RT_END_OF_SIMULATION);
 }
 
@@ -2244,7 +5011,7 @@ void rt_run_interactive(uint64_t stop_time)
 {
    if (aborted)
       errorf("simulation has aborted and must be restarted");
-   else if ((heap_size(eventq_heap) == 0) && (delta_proc == NULL))
+   else if ((eventq_size() == 0) && deltaq_empty())
       warnf("no future simulation events");
    else {
       set_fatal_fn(rt_interactive_fatal);
@@ -2256,23 +5023,170 @@ void rt_run_interactive(uint64_t stop_time)
    }
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// Fork batch mode
+
+// Each test in a batch runs in a child process forked after the design
+// has been initialised so the JIT code and initial signal state are
+// shared copy-on-write. A test is named by a directory which the child
+// changes to before running so relative paths in file declarations
+// select the stimulus and output files for that test.
+
+typedef struct {
+   char     *dir;
+   pid_t     pid;
+   uint64_t  start_ns;
+} fork_test_t;
+
+static unsigned rt_read_fork_list(const char *fname, fork_test_t **tests)
+{
+   FILE *f = fopen(fname, "r");
+   if (f == NULL)
+      fatal_errno("failed to open %s", fname);
+
+   unsigned count = 0, alloc = 16;
+   *tests = xmalloc(sizeof(fork_test_t) * alloc);
+
+   char line[PATH_MAX];
+   while (fgets(line, sizeof(line), f) != NULL) {
+      size_t len = strlen(line);
+      while ((len > 0) && isspace((int)line[len - 1]))
+         line[--len] = '\0';
+
+      // Blank lines and comments are ignored
+      if ((len == 0) || (line[0] == '#'))
+         continue;
+
+      if (count == alloc)
+         *tests = xrealloc(*tests, sizeof(fork_test_t) * (alloc *= 2));
+
+      (*tests)[count].dir = strdup(line);
+      (*tests)[count].pid = -1;
+      count++;
+   }
+
+   fclose(f);
+   return count;
+}
+
+static void rt_fork_child(tree_t top, const char *dir, uint64_t stop_time)
+{
+   if (chdir(dir) != 0)
+      fatal_errno("cannot change directory to %s", dir);
+
+   int fd = open("nvc.log", O_WRONLY | O_CREAT | O_TRUNC, 0644);
+   if (fd < 0)
+      fatal_errno("failed to create %s/nvc.log", dir);
+
+   dup2(fd, STDOUT_FILENO);
+   dup2(fd, STDERR_FILENO);
+   close(fd);
+
+   rt_run_sim(stop_time);
+   rt_end_of_tool(top);
+
+   exit(EXIT_SUCCESS);
+}
+
+static bool rt_fork_report(const fork_test_t *t, int status,
+                           const struct rusage *ru)
+{
+   const double wall = (rt_wall_ns() - t->start_ns) / 1e9;
+   const double cpu  = ru->ru_utime.tv_sec + ru->ru_stime.tv_sec
+      + (ru->ru_utime.tv_usec + ru->ru_stime.tv_usec) / 1e6;
+
+   char result[32];
+   bool pass = false;
+   if (WIFEXITED(status)) {
+      pass = (WEXITSTATUS(status) == EXIT_SUCCESS);
+      checked_sprintf(result, sizeof(result), "%s", pass ? "pass" : "fail");
+   }
+   else if (WIFSIGNALED(status))
+      checked_sprintf(result, sizeof(result), "signal %d", WTERMSIG(status));
+   else
+      checked_sprintf(result, sizeof(result), "status %d", status);
+
+   printf("%-10s wall:%.2fs cpu:%.2fs maxrss:%ldkB  %s\n", result, wall,
+          cpu, ru->ru_maxrss, t->dir);
+   fflush(stdout);
+
+   return pass;
+}
+
+int rt_fork_batch(tree_t top, const char *list, unsigned jobs,
+                  uint64_t stop_time)
+{
+   fork_test_t *tests;
+   const unsigned ntests = rt_read_fork_list(list, &tests);
+
+   if (jobs == 0)
+      jobs = MAX(sysconf(_SC_NPROCESSORS_ONLN), 1);
+
+   unsigned next = 0, running = 0, npass = 0;
+   while ((next < ntests) || (running > 0)) {
+      if ((next < ntests) && (running < jobs)) {
+         fork_test_t *t = &(tests[next++]);
+
+         // Anything buffered now would otherwise be written twice
+         fflush(stdout);
+         fflush(stderr);
+
+         t->start_ns = rt_wall_ns();
+         if ((t->pid = fork()) < 0)
+            fatal_errno("fork");
+         else if (t->pid == 0)
+            rt_fork_child(top, t->dir, stop_time);
+
+         running++;
+         continue;
+      }
+
+      int status;
+      struct rusage ru;
+      const pid_t pid = wait4(-1, &status, 0, &ru);
+      if (pid < 0) {
+         if (errno == EINTR)
+            continue;
+         fatal_errno("wait4");
+      }
+
+      for (unsigned i = 0; i < next; i++) {
+         if (tests[i].pid == pid) {
+            npass += rt_fork_report(&(tests[i]), status, &ru);
+            tests[i].pid = -1;
+            running--;
+            break;
+         }
+      }
+   }
+
+   notef("%u of %u tests passed", npass, ntests);
+
+   for (unsigned i = 0; i < ntests; i++)
+      free(tests[i].dir);
+   free(tests);
+
+   return (npass == ntests) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
 void rt_restart(tree_t top)
 {
    rt_setup(top);
    rt_initial(top);
    aborted = false;
+
+   if (levelise)
+      rt_levelise(top);
 }
 
 void rt_set_timeout_cb(uint64_t when, timeout_fn_t fn, void *user)
 {
    event_t *e = rt_alloc(event_stack);
-   e->when         = now + when;
-   e->kind         = E_TIMEOUT;
-   e->group        = NULL;
-   e->proc         = NULL;
-   e->timeout_fn   = fn;
-   e->timeout_user = user;
-   e->wakeup_gen   = UINT32_MAX;
+   e->when       = now + when;
+   e->kind       = E_TIMEOUT;
+   e->index      = rt_timeout_new(fn, user);
+   e->force      = false;
+   e->wakeup_gen = UINT32_MAX;
 
    deltaq_insert(e);
 }
@@ -2337,14 +5251,22 @@ size_t rt_watch_value(watch_t *w, uint64_t *buf, size_t max, bool last)
    int offset = 0;
    for (int i = 0; (i < w->n_groups) && (offset < max); i++) {
       netgroup_t *g = w->groups[i];
+      void *src = last ? rt_cold(g)->last_value : g->resolved;
 
 #define SIGNAL_VALUE_EXPAND_U64(type) do {                              \
-         const type *sp = (type *)(last ? g->last_value : g->resolved); \
+         const type *sp = (type *)src;                                  \
          for (int j = 0; (j < g->length) && (offset + j < max); j++)    \
             buf[offset + j] = sp[j];                                    \
       } while (0)
 
-      FOR_ALL_SIZES(g->size, SIGNAL_VALUE_EXPAND_U64);
+      if (last && (g->pack != 0)) {
+         uint8_t unpacked[g->length];
+         rt_unpack_value(g, unpacked, src, 0, g->length);
+         for (int j = 0; (j < g->length) && (offset + j < max); j++)
+            buf[offset + j] = unpacked[j];
+      }
+      else
+         FOR_ALL_SIZES(g->size, SIGNAL_VALUE_EXPAND_U64);
 
       offset += g->length;
    }
@@ -2440,14 +5362,16 @@ bool rt_force_signal(tree_t s, const uint64_t *buf, size_t count,
    while (offset < nnets) {
       netid_t nid = tree_net(s, offset);
       netgroup_t *g = &(groups[netdb_lookup(netdb, nid)]);
+      netgroup_cold_t *cold = rt_cold(g);
 
       g->flags |= NET_F_FORCED;
 
-      if (g->forcing == NULL)
-         g->forcing = rt_alloc_value(g);
+      // The forcing value is always unpacked
+      if (cold->forcing == NULL)
+         cold->forcing = xmalloc(sizeof(struct value) + (g->size * g->length));
 
 #define SIGNAL_FORCE_EXPAND_U64(type) do {                              \
-         type *dp = (type *)g->forcing->data;                           \
+         type *dp = (type *)cold->forcing->data;                        \
          for (int i = 0; (i < g->length) && (offset + i < count); i++)  \
             dp[i] = buf[offset + i];                                    \
       } while (0)
@@ -0,0 +1,385 @@
+//
+//  Copyright (C) 2015  Nick Gasson
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "util.h"
+#include "simd.h"
+#include "rt.h"
+
+#include <assert.h>
+#include <string.h>
+
+#if defined __x86_64__ || defined __i386__
+#define HAVE_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+// Vector kernels for the element-wise loops in the simulation kernel.
+// Signal values of enumeration types are stored one byte per element
+// so resolution by table lookup maps directly onto the PSHUFB byte
+// shuffle when the type has at most 16 literals, which includes
+// std_ulogic. Operations on bit vectors work on 0/1 bytes and so can
+// be done a word or vector register at a time with plain bitwise
+// operations. The best implementation the CPU supports is selected at
+// run time and every kernel falls back to portable scalar code.
+
+#define ONES64 UINT64_C(0x0101010101010101)
+
+// Building the per-row shuffle vectors for a two input lookup costs
+// about as much as a hundred scalar lookups
+#define LOOKUP2_MIN_WIDTH 128
+
+static simd_level_t level = SIMD_SCALAR;
+static simd_level_t max_level = SIMD_SCALAR;
+
+static inline uint64_t load64(const uint8_t *p)
+{
+   uint64_t x;
+   memcpy(&x, p, sizeof(uint64_t));
+   return x;
+}
+
+static inline void store64(uint8_t *p, uint64_t x)
+{
+   memcpy(p, &x, sizeof(uint64_t));
+}
+
+#define OP_NOT(x, y, k)  ((x) ^ (k))
+#define OP_AND(x, y, k)  ((x) & (y))
+#define OP_OR(x, y, k)   ((x) | (y))
+#define OP_XOR(x, y, k)  ((x) ^ (y))
+#define OP_XNOR(x, y, k) ((x) ^ (y) ^ (k))
+#define OP_NAND(x, y, k) (((x) & (y)) ^ (k))
+#define OP_NOR(x, y, k)  (((x) | (y)) ^ (k))
+
+#define FOR_ALL_BIT_OPS(kind, macro) do {               \
+      switch (kind) {                                   \
+      case BIT_VEC_NOT:  macro(OP_NOT); break;          \
+      case BIT_VEC_AND:  macro(OP_AND); break;          \
+      case BIT_VEC_OR:   macro(OP_OR); break;           \
+      case BIT_VEC_XOR:  macro(OP_XOR); break;          \
+      case BIT_VEC_XNOR: macro(OP_XNOR); break;         \
+      case BIT_VEC_NAND: macro(OP_NAND); break;         \
+      case BIT_VEC_NOR:  macro(OP_NOR); break;          \
+      }                                                 \
+   } while (0)
+
+static void lookup1_scalar(uint8_t *out, const uint8_t *in, size_t n,
+                           const uint8_t *tab)
+{
+   for (size_t i = 0; i < n; i++)
+      out[i] = tab[in[i]];
+}
+
+static void lookup2_scalar(uint8_t *out, const uint8_t *a, const uint8_t *b,
+                           size_t n, const uint8_t *tab, unsigned nlits)
+{
+   for (size_t i = 0; i < n; i++)
+      out[i] = tab[(a[i] * nlits) + b[i]];
+}
+
+static void bit_vec_op_scalar(int kind, uint8_t *out, const uint8_t *a,
+                              const uint8_t *b, size_t n)
+{
+#define SCALAR_BIT_LOOP(op) do {                                        \
+      size_t i = 0;                                                     \
+      for (; i + 8 <= n; i += 8)                                        \
+         store64(out + i, op(load64(a + i), load64(b + i), ONES64));    \
+      for (; i < n; i++)                                                \
+         out[i] = op(a[i], b[i], 1);                                    \
+   } while (0)
+
+   FOR_ALL_BIT_OPS(kind, SCALAR_BIT_LOOP);
+}
+
+#ifdef HAVE_X86_SIMD
+
+#define VEC_NOT(x, y, k)  _mm_xor_si128((x), (k))
+#define VEC_AND(x, y, k)  _mm_and_si128((x), (y))
+#define VEC_OR(x, y, k)   _mm_or_si128((x), (y))
+#define VEC_XOR(x, y, k)  _mm_xor_si128((x), (y))
+#define VEC_XNOR(x, y, k) _mm_xor_si128(_mm_xor_si128((x), (y)), (k))
+#define VEC_NAND(x, y, k) _mm_xor_si128(_mm_and_si128((x), (y)), (k))
+#define VEC_NOR(x, y, k)  _mm_xor_si128(_mm_or_si128((x), (y)), (k))
+
+#define YMM_NOT(x, y, k)  _mm256_xor_si256((x), (k))
+#define YMM_AND(x, y, k)  _mm256_and_si256((x), (y))
+#define YMM_OR(x, y, k)   _mm256_or_si256((x), (y))
+#define YMM_XOR(x, y, k)  _mm256_xor_si256((x), (y))
+#define YMM_XNOR(x, y, k) _mm256_xor_si256(_mm256_xor_si256((x), (y)), (k))
+#define YMM_NAND(x, y, k) _mm256_xor_si256(_mm256_and_si256((x), (y)), (k))
+#define YMM_NOR(x, y, k)  _mm256_xor_si256(_mm256_or_si256((x), (y)), (k))
+
+__attribute__((target("ssse3")))
+static void lookup1_ssse3(uint8_t *out, const uint8_t *in, size_t n,
+                          const uint8_t *tab, unsigned ntab)
+{
+   uint8_t padded[16] = { 0 };
+   memcpy(padded, tab, ntab);
+
+   const __m128i t = _mm_loadu_si128((const __m128i *)padded);
+
+   size_t i = 0;
+   for (; i + 16 <= n; i += 16) {
+      const __m128i x = _mm_loadu_si128((const __m128i *)(in + i));
+      _mm_storeu_si128((__m128i *)(out + i), _mm_shuffle_epi8(t, x));
+   }
+
+   lookup1_scalar(out + i, in + i, n - i, tab);
+}
+
+__attribute__((target("ssse3")))
+static void lookup2_ssse3(uint8_t *out, const uint8_t *a, const uint8_t *b,
+                          size_t n, const uint8_t *tab, unsigned nlits)
+{
+   // Look up the column in every row of the table and then select the
+   // row for each element with a mask
+
+   uint8_t padded[16][16];
+   __m128i rows[16];
+   for (unsigned r = 0; r < nlits; r++) {
+      memset(padded[r], '\0', 16);
+      memcpy(padded[r], tab + (r * nlits), nlits);
+      rows[r] = _mm_loadu_si128((const __m128i *)padded[r]);
+   }
+
+   size_t i = 0;
+   for (; i + 16 <= n; i += 16) {
+      const __m128i x = _mm_loadu_si128((const __m128i *)(a + i));
+      const __m128i y = _mm_loadu_si128((const __m128i *)(b + i));
+
+      __m128i acc = _mm_setzero_si128();
+      for (unsigned r = 0; r < nlits; r++) {
+         const __m128i m = _mm_cmpeq_epi8(x, _mm_set1_epi8(r));
+         const __m128i v = _mm_shuffle_epi8(rows[r], y);
+         acc = _mm_or_si128(acc, _mm_and_si128(m, v));
+      }
+
+      _mm_storeu_si128((__m128i *)(out + i), acc);
+   }
+
+   lookup2_scalar(out + i, a + i, b + i, n - i, tab, nlits);
+}
+
+__attribute__((target("ssse3")))
+static void bit_vec_op_ssse3(int kind, uint8_t *out, const uint8_t *a,
+                             const uint8_t *b, size_t n)
+{
+   const __m128i ones = _mm_set1_epi8(1);
+
+   size_t i = 0;
+
+#define SSE_BIT_LOOP(op) do {                                           \
+      for (; i + 16 <= n; i += 16) {                                    \
+         const __m128i x = _mm_loadu_si128((const __m128i *)(a + i));   \
+         const __m128i y = _mm_loadu_si128((const __m128i *)(b + i));   \
+         (void)y;                                                       \
+         _mm_storeu_si128((__m128i *)(out + i), op(x, y, ones));        \
+      }                                                                 \
+   } while (0)
+
+   switch (kind) {
+   case BIT_VEC_NOT:  SSE_BIT_LOOP(VEC_NOT); break;
+   case BIT_VEC_AND:  SSE_BIT_LOOP(VEC_AND); break;
+   case BIT_VEC_OR:   SSE_BIT_LOOP(VEC_OR); break;
+   case BIT_VEC_XOR:  SSE_BIT_LOOP(VEC_XOR); break;
+   case BIT_VEC_XNOR: SSE_BIT_LOOP(VEC_XNOR); break;
+   case BIT_VEC_NAND: SSE_BIT_LOOP(VEC_NAND); break;
+   case BIT_VEC_NOR:  SSE_BIT_LOOP(VEC_NOR); break;
+   }
+
+   bit_vec_op_scalar(kind, out + i, a + i, b + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static void lookup1_avx2(uint8_t *out, const uint8_t *in, size_t n,
+                         const uint8_t *tab, unsigned ntab)
+{
+   uint8_t padded[16] = { 0 };
+   memcpy(padded, tab, ntab);
+
+   // VPSHUFB works within each 128-bit lane so both need the table
+   const __m128i t128 = _mm_loadu_si128((const __m128i *)padded);
+   const __m256i t =
+      _mm256_inserti128_si256(_mm256_castsi128_si256(t128), t128, 1);
+
+   size_t i = 0;
+   for (; i + 32 <= n; i += 32) {
+      const __m256i x = _mm256_loadu_si256((const __m256i *)(in + i));
+      _mm256_storeu_si256((__m256i *)(out + i), _mm256_shuffle_epi8(t, x));
+   }
+
+   lookup1_scalar(out + i, in + i, n - i, tab);
+}
+
+__attribute__((target("avx2")))
+static void lookup2_avx2(uint8_t *out, const uint8_t *a, const uint8_t *b,
+                         size_t n, const uint8_t *tab, unsigned nlits)
+{
+   uint8_t padded[16][16];
+   __m256i rows[16];
+   for (unsigned r = 0; r < nlits; r++) {
+      memset(padded[r], '\0', 16);
+      memcpy(padded[r], tab + (r * nlits), nlits);
+      const __m128i row = _mm_loadu_si128((const __m128i *)padded[r]);
+      rows[r] = _mm256_inserti128_si256(_mm256_castsi128_si256(row), row, 1);
+   }
+
+   size_t i = 0;
+   for (; i + 32 <= n; i += 32) {
+      const __m256i x = _mm256_loadu_si256((const __m256i *)(a + i));
+      const __m256i y = _mm256_loadu_si256((const __m256i *)(b + i));
+
+      __m256i acc = _mm256_setzero_si256();
+      for (unsigned r = 0; r < nlits; r++) {
+         const __m256i m = _mm256_cmpeq_epi8(x, _mm256_set1_epi8(r));
+         const __m256i v = _mm256_shuffle_epi8(rows[r], y);
+         acc = _mm256_or_si256(acc, _mm256_and_si256(m, v));
+      }
+
+      _mm256_storeu_si256((__m256i *)(out + i), acc);
+   }
+
+   lookup2_scalar(out + i, a + i, b + i, n - i, tab, nlits);
+}
+
+__attribute__((target("avx2")))
+static void bit_vec_op_avx2(int kind, uint8_t *out, const uint8_t *a,
+                            const uint8_t *b, size_t n)
+{
+   const __m256i ones = _mm256_set1_epi8(1);
+
+   size_t i = 0;
+
+#define AVX2_BIT_LOOP(op) do {                                          \
+      for (; i + 32 <= n; i += 32) {                                    \
+         const __m256i x = _mm256_loadu_si256((const __m256i *)(a + i)); \
+         const __m256i y = _mm256_loadu_si256((const __m256i *)(b + i)); \
+         (void)y;                                                       \
+         _mm256_storeu_si256((__m256i *)(out + i), op(x, y, ones));     \
+      }                                                                 \
+   } while (0)
+
+   switch (kind) {
+   case BIT_VEC_NOT:  AVX2_BIT_LOOP(YMM_NOT); break;
+   case BIT_VEC_AND:  AVX2_BIT_LOOP(YMM_AND); break;
+   case BIT_VEC_OR:   AVX2_BIT_LOOP(YMM_OR); break;
+   case BIT_VEC_XOR:  AVX2_BIT_LOOP(YMM_XOR); break;
+   case BIT_VEC_XNOR: AVX2_BIT_LOOP(YMM_XNOR); break;
+   case BIT_VEC_NAND: AVX2_BIT_LOOP(YMM_NAND); break;
+   case BIT_VEC_NOR:  AVX2_BIT_LOOP(YMM_NOR); break;
+   }
+
+   bit_vec_op_scalar(kind, out + i, a + i, b + i, n - i);
+}
+
+#endif  // HAVE_X86_SIMD
+
+simd_level_t simd_init(void)
+{
+#ifdef HAVE_X86_SIMD
+   __builtin_cpu_init();
+   if (__builtin_cpu_supports("avx2"))
+      max_level = SIMD_AVX2;
+   else if (__builtin_cpu_supports("ssse3"))
+      max_level = SIMD_SSSE3;
+#endif
+
+   return (level = max_level);
+}
+
+simd_level_t simd_set_level(simd_level_t want)
+{
+   // Used to compare implementations: never selects a level the CPU
+   // does not support
+   return (level = MIN(want, max_level));
+}
+
+const char *simd_level_str(simd_level_t l)
+{
+   const char *names[] = { "scalar", "ssse3", "avx2" };
+   assert(l < ARRAY_LEN(names));
+   return names[l];
+}
+
+void simd_lookup1(uint8_t *out, const uint8_t *in, size_t n,
+                  const uint8_t *tab, unsigned ntab)
+{
+#ifdef HAVE_X86_SIMD
+   if ((ntab <= 16) && (n >= 16)) {
+      switch (level) {
+      case SIMD_AVX2:
+         lookup1_avx2(out, in, n, tab, ntab);
+         return;
+      case SIMD_SSSE3:
+         lookup1_ssse3(out, in, n, tab, ntab);
+         return;
+      case SIMD_SCALAR:
+         break;
+      }
+   }
+#endif
+
+   lookup1_scalar(out, in, n, tab);
+}
+
+void simd_lookup2(uint8_t *out, const uint8_t *a, const uint8_t *b,
+                  size_t n, const uint8_t *tab, unsigned nlits)
+{
+   // The output may be the same as the first input
+
+#ifdef HAVE_X86_SIMD
+   if ((nlits <= 16) && (n >= LOOKUP2_MIN_WIDTH)) {
+      switch (level) {
+      case SIMD_AVX2:
+         lookup2_avx2(out, a, b, n, tab, nlits);
+         return;
+      case SIMD_SSSE3:
+         lookup2_ssse3(out, a, b, n, tab, nlits);
+         return;
+      case SIMD_SCALAR:
+         break;
+      }
+   }
+#endif
+
+   lookup2_scalar(out, a, b, n, tab, nlits);
+}
+
+void simd_bit_vec_op(int kind, uint8_t *out, const uint8_t *a,
+                     const uint8_t *b, size_t n)
+{
+   // Elements must be zero or one. The second operand is ignored for
+   // NOT and may be NULL.
+
+   if (kind == BIT_VEC_NOT)
+      b = a;
+
+#ifdef HAVE_X86_SIMD
+   switch (level) {
+   case SIMD_AVX2:
+      bit_vec_op_avx2(kind, out, a, b, n);
+      return;
+   case SIMD_SSSE3:
+      bit_vec_op_ssse3(kind, out, a, b, n);
+      return;
+   case SIMD_SCALAR:
+      break;
+   }
+#endif
+
+   bit_vec_op_scalar(kind, out, a, b, n);
+}
@@ -0,0 +1,41 @@
+//
+//  Copyright (C) 2015  Nick Gasson
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef _SIMD_H
+#define _SIMD_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum {
+   SIMD_SCALAR,
+   SIMD_SSSE3,
+   SIMD_AVX2
+} simd_level_t;
+
+simd_level_t simd_init(void);
+simd_level_t simd_set_level(simd_level_t level);
+const char *simd_level_str(simd_level_t level);
+
+void simd_lookup1(uint8_t *out, const uint8_t *in, size_t n,
+                  const uint8_t *tab, unsigned ntab);
+void simd_lookup2(uint8_t *out, const uint8_t *a, const uint8_t *b,
+                  size_t n, const uint8_t *tab, unsigned nlits);
+void simd_bit_vec_op(int kind, uint8_t *out, const uint8_t *a,
+                     const uint8_t *b, size_t n);
+
+#endif  // _SIMD_H
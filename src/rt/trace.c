@@ -0,0 +1,373 @@
+//
+//  Copyright (C) 2015  Nick Gasson
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "trace.h"
+#include "common.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <fnmatch.h>
+#include <pthread.h>
+
+// Binary simulation trace. Each thread appends fixed size records to
+// its own buffer without any locking and writes the whole buffer to the
+// trace file when it fills up. Buffers from different threads may be
+// written out of order so the decoder sorts records by time and delta
+// cycle, keeping the order in the file for records in the same cycle.
+//
+// The file starts with a trace_header_t followed by the name of each
+// process and then each signal group as NUL terminated strings and
+// finally the records.
+
+#define RING_RECS 4096
+
+typedef struct trace_ring trace_ring_t;
+
+struct trace_ring {
+   trace_rec_t   recs[RING_RECS];
+   unsigned      count;
+   trace_ring_t *next;
+};
+
+typedef struct {
+   char   **globs;
+   unsigned count;
+} glob_list_t;
+
+static FILE            *trace_file = NULL;
+static trace_ring_t    *all_rings = NULL;
+static pthread_mutex_t  ring_lock = PTHREAD_MUTEX_INITIALIZER;
+static uint8_t         *proc_sel = NULL;
+static uint8_t         *group_sel = NULL;
+static glob_list_t      proc_globs;
+static glob_list_t      signal_globs;
+
+static __thread trace_ring_t *my_ring = NULL;
+
+static const char *kind_names[TRACE_NKINDS] = {
+   "run", "wakeup", "sched", "update"
+};
+
+static void trace_add_glob(glob_list_t *list, const char *glob)
+{
+   list->globs = xrealloc(list->globs, (list->count + 1) * sizeof(char *));
+   list->globs[(list->count)++] = strdup(glob);
+}
+
+static void trace_free_globs(glob_list_t *list)
+{
+   for (unsigned i = 0; i < list->count; i++)
+      free(list->globs[i]);
+   free(list->globs);
+
+   list->globs = NULL;
+   list->count = 0;
+}
+
+static uint8_t *trace_select(glob_list_t *list, unsigned n,
+                             trace_name_fn_t name_fn)
+{
+   // Returns a table of which objects match the filter or NULL if all
+   // objects should be traced
+
+   if (list->count == 0)
+      return NULL;
+
+   uint8_t *sel = xmalloc(MAX(n, 1));
+   for (unsigned i = 0; i < n; i++) {
+      const char *name = (*name_fn)(i);
+
+      sel[i] = 0;
+      for (unsigned j = 0; (j < list->count) && !sel[i]; j++)
+         sel[i] = (fnmatch(list->globs[j], name, 0) == 0);
+   }
+
+   return sel;
+}
+
+static void trace_write_names(unsigned n, trace_name_fn_t name_fn)
+{
+   for (unsigned i = 0; i < n; i++) {
+      const char *name = (*name_fn)(i);
+      fwrite(name, strlen(name) + 1, 1, trace_file);
+   }
+}
+
+static void trace_flush(trace_ring_t *r)
+{
+   // The C library serialises concurrent writes to the same stream
+   if ((r->count > 0) && (fwrite(r->recs, sizeof(trace_rec_t), r->count,
+                                 trace_file) != r->count))
+      fatal_errno("failed to write trace");
+
+   r->count = 0;
+}
+
+static trace_ring_t *trace_new_ring(void)
+{
+   trace_ring_t *r = xmalloc(sizeof(trace_ring_t));
+   r->count = 0;
+
+   pthread_mutex_lock(&ring_lock);
+   r->next = all_rings;
+   all_rings = r;
+   pthread_mutex_unlock(&ring_lock);
+
+   return (my_ring = r);
+}
+
+static uint32_t trace_hash(const void *value, size_t len)
+{
+   // 32-bit FNV-1a
+   const uint8_t *p = value;
+   uint32_t hash = 2166136261u;
+   for (size_t i = 0; i < len; i++) {
+      hash ^= p[i];
+      hash *= 16777619u;
+   }
+   return hash;
+}
+
+void trace_filter_proc(const char *glob)
+{
+   trace_add_glob(&proc_globs, glob);
+}
+
+void trace_filter_signal(const char *glob)
+{
+   trace_add_glob(&signal_globs, glob);
+}
+
+void trace_open(const char *fname, unsigned nprocs, trace_name_fn_t proc_name,
+                unsigned ngroups, trace_name_fn_t group_name)
+{
+   assert(trace_file == NULL);
+
+   if ((trace_file = fopen(fname, "w")) == NULL)
+      fatal_errno("failed to open %s", fname);
+
+   const trace_header_t header = {
+      .magic   = TRACE_MAGIC,
+      .version = TRACE_VERSION,
+      .nprocs  = nprocs,
+      .ngroups = ngroups
+   };
+   fwrite(&header, sizeof(header), 1, trace_file);
+
+   trace_write_names(nprocs, proc_name);
+   trace_write_names(ngroups, group_name);
+
+   proc_sel  = trace_select(&proc_globs, nprocs, proc_name);
+   group_sel = trace_select(&signal_globs, ngroups, group_name);
+}
+
+void trace_close(void)
+{
+   if (trace_file == NULL)
+      return;
+
+   // Other threads must have stopped recording by now
+   while (all_rings != NULL) {
+      trace_ring_t *next = all_rings->next;
+      trace_flush(all_rings);
+      free(all_rings);
+      all_rings = next;
+   }
+   my_ring = NULL;
+
+   fclose(trace_file);
+   trace_file = NULL;
+
+   free(proc_sel);
+   free(group_sel);
+   proc_sel = group_sel = NULL;
+
+   trace_free_globs(&proc_globs);
+   trace_free_globs(&signal_globs);
+}
+
+bool trace_enabled(void)
+{
+   return trace_file != NULL;
+}
+
+void trace_record(trace_kind_t kind, uint64_t when, uint32_t delta,
+                  uint32_t proc, uint32_t group, const void *value,
+                  size_t len)
+{
+   if ((proc != TRACE_NONE) && (proc_sel != NULL) && !proc_sel[proc])
+      return;
+   else if ((group != TRACE_NONE) && (group_sel != NULL) && !group_sel[group])
+      return;
+
+   trace_ring_t *r = my_ring ?: trace_new_ring();
+   if (unlikely(r->count == RING_RECS))
+      trace_flush(r);
+
+   trace_rec_t *rec = &(r->recs[(r->count)++]);
+   rec->when  = when;
+   rec->delta = delta;
+   rec->proc  = proc;
+   rec->group = group;
+   rec->hash  = (value != NULL) ? trace_hash(value, len) : 0;
+   rec->kind  = kind;
+   memset(rec->reserved, '\0', sizeof(rec->reserved));
+}
+
+static char **trace_read_names(FILE *f, unsigned n, const char *fname)
+{
+   char **names = xmalloc(sizeof(char *) * MAX(n, 1));
+
+   size_t bufsz = 256;
+   char *buf = xmalloc(bufsz);
+
+   for (unsigned i = 0; i < n; i++) {
+      size_t len = 0;
+      int ch;
+      while ((ch = fgetc(f)) != '\0') {
+         if (ch == EOF)
+            fatal("%s: truncated name table", fname);
+         else if (len + 1 == bufsz)
+            buf = xrealloc(buf, (bufsz *= 2));
+         buf[len++] = ch;
+      }
+      buf[len] = '\0';
+      names[i] = strdup(buf);
+   }
+
+   free(buf);
+   return names;
+}
+
+static const trace_rec_t *sort_recs;
+
+static int trace_rec_cmp(const void *a, const void *b)
+{
+   const uint32_t ia = *(const uint32_t *)a;
+   const uint32_t ib = *(const uint32_t *)b;
+
+   const trace_rec_t *ra = &(sort_recs[ia]);
+   const trace_rec_t *rb = &(sort_recs[ib]);
+
+   if (ra->when != rb->when)
+      return (ra->when > rb->when) ? 1 : -1;
+   else if (ra->delta != rb->delta)
+      return (ra->delta > rb->delta) ? 1 : -1;
+   else
+      return (ia > ib) - (ia < ib);
+}
+
+static void trace_csv_str(FILE *out, const char *str)
+{
+   fputc('"', out);
+   for (const char *p = str; *p != '\0'; p++) {
+      if (*p == '"')
+         fputc('"', out);
+      fputc(*p, out);
+   }
+   fputc('"', out);
+}
+
+void trace_decode(const char *fname, bool csv)
+{
+   FILE *out = stdout;
+
+   FILE *f = fopen(fname, "r");
+   if (f == NULL)
+      fatal_errno("failed to open %s", fname);
+
+   trace_header_t header;
+   if (fread(&header, sizeof(header), 1, f) != 1)
+      fatal("%s: file too short", fname);
+   else if (header.magic != TRACE_MAGIC)
+      fatal("%s: not a trace file", fname);
+   else if (header.version != TRACE_VERSION)
+      fatal("%s: unsupported trace version %u", fname, header.version);
+
+   char **procs  = trace_read_names(f, header.nprocs, fname);
+   char **groups = trace_read_names(f, header.ngroups, fname);
+
+   size_t nrecs = 0, max_recs = RING_RECS;
+   trace_rec_t *recs = xmalloc(max_recs * sizeof(trace_rec_t));
+
+   size_t nread;
+   while ((nread = fread(recs + nrecs, sizeof(trace_rec_t),
+                         max_recs - nrecs, f)) > 0) {
+      nrecs += nread;
+      if (nrecs == max_recs) {
+         max_recs *= 2;
+         recs = xrealloc(recs, max_recs * sizeof(trace_rec_t));
+      }
+   }
+
+   fclose(f);
+
+   uint32_t *order = xmalloc(MAX(nrecs, 1) * sizeof(uint32_t));
+   for (size_t i = 0; i < nrecs; i++)
+      order[i] = i;
+
+   sort_recs = recs;
+   qsort(order, nrecs, sizeof(uint32_t), trace_rec_cmp);
+
+   if (csv)
+      fprintf(out, "time_fs,delta,kind,process,signal,hash\n");
+
+   for (size_t i = 0; i < nrecs; i++) {
+      const trace_rec_t *r = &(recs[order[i]]);
+
+      if ((r->kind >= TRACE_NKINDS)
+          || ((r->proc != TRACE_NONE) && (r->proc >= header.nprocs))
+          || ((r->group != TRACE_NONE) && (r->group >= header.ngroups)))
+         fatal("%s: corrupt record %zu", fname, (size_t)order[i]);
+
+      const char *proc  = (r->proc == TRACE_NONE) ? "" : procs[r->proc];
+      const char *group = (r->group == TRACE_NONE) ? "" : groups[r->group];
+
+      if (csv) {
+         fprintf(out, "%"PRIu64",%u,%s,", r->when, r->delta,
+                 kind_names[r->kind]);
+         trace_csv_str(out, proc);
+         fputc(',', out);
+         trace_csv_str(out, group);
+         fprintf(out, ",%08x\n", r->hash);
+      }
+      else {
+         fprintf(out, "%s+%u\t%-6s", fmt_time(r->when), r->delta,
+                 kind_names[r->kind]);
+         if (*proc != '\0')
+            fprintf(out, " %s", proc);
+         if (*group != '\0')
+            fprintf(out, " %s", group);
+         if ((r->kind == TRACE_SCHED) || (r->kind == TRACE_UPDATE))
+            fprintf(out, " value=%08x", r->hash);
+         fputc('\n', out);
+      }
+   }
+
+   for (unsigned i = 0; i < header.nprocs; i++)
+      free(procs[i]);
+   for (unsigned i = 0; i < header.ngroups; i++)
+      free(groups[i]);
+
+   free(procs);
+   free(groups);
+   free(recs);
+   free(order);
+}
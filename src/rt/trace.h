@@ -0,0 +1,66 @@
+//
+//  Copyright (C) 2015  Nick Gasson
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef _TRACE_H
+#define _TRACE_H
+
+#include "util.h"
+#include "rt.h"
+
+#include <stdint.h>
+
+#define TRACE_MAGIC   0x5443564e   // NVCT
+#define TRACE_VERSION 1
+#define TRACE_NONE    UINT32_MAX
+
+typedef enum {
+   TRACE_RUN,
+   TRACE_WAKEUP,
+   TRACE_SCHED,
+   TRACE_UPDATE,
+
+   TRACE_NKINDS
+} trace_kind_t;
+
+typedef struct {
+   uint32_t magic;
+   uint32_t version;
+   uint32_t nprocs;
+   uint32_t ngroups;
+} trace_header_t;
+
+typedef struct {
+   uint64_t when;
+   uint32_t delta;
+   uint32_t proc;
+   uint32_t group;
+   uint32_t hash;
+   uint8_t  kind;
+   uint8_t  reserved[7];
+} trace_rec_t;
+
+typedef const char *(*trace_name_fn_t)(unsigned index);
+
+void trace_open(const char *fname, unsigned nprocs, trace_name_fn_t proc_name,
+                unsigned ngroups, trace_name_fn_t group_name);
+void trace_close(void);
+bool trace_enabled(void);
+void trace_record(trace_kind_t kind, uint64_t when, uint32_t delta,
+                  uint32_t proc, uint32_t group, const void *value,
+                  size_t len);
+
+#endif  // _TRACE_H
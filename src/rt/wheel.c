@@ -0,0 +1,391 @@
+//
+//  Copyright (C) 2015  Nick Gasson
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "util.h"
+#include "wheel.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Hierarchical timing wheel with the same interface as the binary heap
+// in heap.c. Each level has 64 slots and resolves six bits of the key
+// relative to a base which is the key of the last extracted element. A
+// key is filed at the level of the most significant chunk in which it
+// differs from the base so insertion is constant time. Finding the
+// minimum scans the occupancy bitmaps from the lowest level upwards and
+// cascades the first non-empty slot down to the levels below. Each
+// element can only cascade once per level so extraction is amortised
+// constant time for the near-future events that dominate simulation.
+//
+// Slots are arrays rather than linked lists so cascading a slot is a
+// sequential scan which is much kinder to the cache than chasing
+// pointers through a node pool.
+//
+// Each element is given a handle when it is inserted. Deleting an
+// element by handle is constant time: the handle is marked dead and the
+// entry is discarded without further work the next time its slot is
+// cascaded or reaches the front of the queue.
+//
+// Peeking at the minimum cascades the wheel and moves the base up to
+// the next event. The kernel peeks at every time step and processes
+// may then schedule events before the one it found so keys smaller than
+// the base go in a small binary heap of early entries instead. These
+// are always smaller than every key in the wheel and so are extracted
+// first. Elements with equal keys are extracted in insertion order.
+
+#define SLOT_BITS  6
+#define SLOTS      (1 << SLOT_BITS)
+#define SLOT_MASK  (SLOTS - 1)
+#define LEVELS     ((64 + SLOT_BITS - 1) / SLOT_BITS)
+#define INIT_SLOT  16
+#define INIT_HANDS 512
+
+typedef enum {
+   H_FREE, H_LIVE, H_DEAD
+} handle_state_t;
+
+struct entry {
+   uint64_t  key;
+   void     *user;
+   uint32_t  handle;
+   uint32_t  seq;
+};
+
+struct slot {
+   struct entry *entries;
+   uint32_t      head;
+   uint32_t      count;
+   uint32_t      max;
+};
+
+struct wheel {
+   size_t      size;
+   uint64_t    base;
+   uint8_t    *states;
+   uint32_t   *free_handles;
+   uint32_t    n_free;
+   uint32_t    max_handles;
+   uint64_t    occupied[LEVELS];
+   struct slot slots[LEVELS][SLOTS];
+   struct slot early;
+   uint32_t    early_seq;
+};
+
+static inline int wheel_level(wheel_t w, uint64_t key)
+{
+   const uint64_t diff = key ^ w->base;
+   if (diff == 0)
+      return 0;
+   else
+      return (63 - __builtin_clzll(diff)) / SLOT_BITS;
+}
+
+static inline bool wheel_reclaim(wheel_t w, const struct entry *e)
+{
+   // Returns true if the entry was deleted and the handle reclaimed
+
+   if (likely(w->states[e->handle] == H_LIVE))
+      return false;
+
+   assert(w->states[e->handle] == H_DEAD);
+   w->states[e->handle] = H_FREE;
+   w->free_handles[(w->n_free)++] = e->handle;
+   return true;
+}
+
+static void wheel_add_handles(wheel_t w, uint32_t first, uint32_t last)
+{
+   for (uint32_t i = last; i > first; i--) {
+      w->states[i - 1] = H_FREE;
+      w->free_handles[(w->n_free)++] = i - 1;
+   }
+}
+
+static inline void wheel_file(wheel_t w, const struct entry *e)
+{
+   const int level = wheel_level(w, e->key);
+   const int index = (e->key >> (level * SLOT_BITS)) & SLOT_MASK;
+
+   struct slot *s = &(w->slots[level][index]);
+   if (unlikely(s->count == s->max)) {
+      s->max = (s->max == 0) ? INIT_SLOT : s->max * 2;
+      s->entries = xrealloc(s->entries, s->max * sizeof(struct entry));
+   }
+
+   s->entries[(s->count)++] = *e;
+
+   w->occupied[level] |= UINT64_C(1) << index;
+}
+
+static inline bool wheel_early_less(const struct entry *a,
+                                    const struct entry *b)
+{
+   return (a->key < b->key) || ((a->key == b->key) && (a->seq < b->seq));
+}
+
+static void wheel_early_push(wheel_t w, struct entry *e)
+{
+   struct slot *h = &(w->early);
+   if (unlikely(h->count == h->max)) {
+      h->max = (h->max == 0) ? INIT_SLOT : h->max * 2;
+      h->entries = xrealloc(h->entries, h->max * sizeof(struct entry));
+   }
+
+   // Sequence numbers keep equal keys in insertion order and restart
+   // whenever the heap is empty so cannot wrap in practice
+   if (h->count == 0)
+      w->early_seq = 0;
+   e->seq = (w->early_seq)++;
+
+   uint32_t pos = (h->count)++;
+   while (pos > 0) {
+      const uint32_t parent = (pos - 1) / 2;
+      if (!wheel_early_less(e, &(h->entries[parent])))
+         break;
+      h->entries[pos] = h->entries[parent];
+      pos = parent;
+   }
+   h->entries[pos] = *e;
+}
+
+static void wheel_early_pop(wheel_t w)
+{
+   struct slot *h = &(w->early);
+   assert(h->count > 0);
+
+   const struct entry last = h->entries[--(h->count)];
+
+   uint32_t pos = 0;
+   for (;;) {
+      uint32_t child = 2 * pos + 1;
+      if (child >= h->count)
+         break;
+      else if ((child + 1 < h->count)
+               && wheel_early_less(&(h->entries[child + 1]),
+                                   &(h->entries[child])))
+         child++;
+
+      if (!wheel_early_less(&(h->entries[child]), &last))
+         break;
+
+      h->entries[pos] = h->entries[child];
+      pos = child;
+   }
+
+   if (h->count > 0)
+      h->entries[pos] = last;
+}
+
+static const struct entry *wheel_early_first(wheel_t w)
+{
+   // Returns the smallest live early entry or NULL if there are none
+
+   struct slot *h = &(w->early);
+   while ((h->count > 0) && wheel_reclaim(w, &(h->entries[0])))
+      wheel_early_pop(w);
+
+   return (h->count > 0) ? &(h->entries[0]) : NULL;
+}
+
+static struct slot *wheel_first(wheel_t w)
+{
+   // Cascade higher levels down until the minimum is in level zero
+
+   if (unlikely(w->size == 0))
+      fatal_trace("wheel underflow");
+
+   for (;;) {
+      if (w->occupied[0] != 0) {
+         const int index = __builtin_ctzll(w->occupied[0]);
+         struct slot *s = &(w->slots[0][index]);
+
+         // Discard any deleted entries at the front of the slot
+         while ((s->head < s->count)
+                && wheel_reclaim(w, &(s->entries[s->head])))
+            (s->head)++;
+
+         if (s->head < s->count)
+            return s;
+
+         w->occupied[0] &= ~(UINT64_C(1) << index);
+         s->head = s->count = 0;
+         continue;
+      }
+
+      int level = 1;
+      while (w->occupied[level] == 0)
+         level++;
+
+      const int index = __builtin_ctzll(w->occupied[level]);
+      struct slot *s = &(w->slots[level][index]);
+
+      // Advance the base to the start of this slot and redistribute
+      // its contents among the lower levels
+      const int shift = level * SLOT_BITS;
+      const int above = shift + SLOT_BITS;
+      const uint64_t high_mask =
+         (above >= 64) ? 0 : ~((UINT64_C(1) << above) - 1);
+      w->base = (w->base & high_mask) | ((uint64_t)index << shift);
+
+      w->occupied[level] &= ~(UINT64_C(1) << index);
+
+      for (uint32_t i = s->head; i < s->count; i++) {
+         if (!wheel_reclaim(w, &(s->entries[i])))
+            wheel_file(w, &(s->entries[i]));
+      }
+
+      s->head = s->count = 0;
+   }
+}
+
+wheel_t wheel_new(void)
+{
+   struct wheel *w = xmalloc(sizeof(struct wheel));
+   memset(w, '\0', sizeof(struct wheel));
+
+   w->max_handles  = INIT_HANDS;
+   w->states       = xmalloc(INIT_HANDS * sizeof(uint8_t));
+   w->free_handles = xmalloc(INIT_HANDS * sizeof(uint32_t));
+
+   wheel_add_handles(w, 0, INIT_HANDS);
+
+   return w;
+}
+
+void wheel_free(wheel_t w)
+{
+   free(w->early.entries);
+
+   for (int level = 0; level < LEVELS; level++) {
+      for (int index = 0; index < SLOTS; index++)
+         free(w->slots[level][index].entries);
+   }
+
+   free(w->states);
+   free(w->free_handles);
+   free(w);
+}
+
+void *wheel_extract_min(wheel_t w)
+{
+   const struct entry *early = wheel_early_first(w);
+   if (early != NULL) {
+      void *user = early->user;
+
+      w->states[early->handle] = H_FREE;
+      w->free_handles[(w->n_free)++] = early->handle;
+
+      wheel_early_pop(w);
+      --(w->size);
+
+      return user;
+   }
+
+   struct slot *s = wheel_first(w);
+
+   const struct entry *e = &(s->entries[(s->head)++]);
+
+   w->states[e->handle] = H_FREE;
+   w->free_handles[(w->n_free)++] = e->handle;
+
+   if (s->head == s->count) {
+      const int index = s - w->slots[0];
+      w->occupied[0] &= ~(UINT64_C(1) << index);
+      s->head = s->count = 0;
+   }
+
+   w->base = e->key;
+   --(w->size);
+
+   return e->user;
+}
+
+void *wheel_min(wheel_t w)
+{
+   const struct entry *early = wheel_early_first(w);
+   if (early != NULL)
+      return early->user;
+
+   struct slot *s = wheel_first(w);
+   return s->entries[s->head].user;
+}
+
+uint32_t wheel_insert(wheel_t w, uint64_t key, void *user)
+{
+   if (unlikely(w->n_free == 0)) {
+      // Deleted entries still hold their handles so the table may need
+      // to grow even if the size is well below the maximum
+      const uint32_t old_max = w->max_handles;
+      w->max_handles *= 2;
+      w->states = xrealloc(w->states, w->max_handles * sizeof(uint8_t));
+      w->free_handles = xrealloc(w->free_handles,
+                                 w->max_handles * sizeof(uint32_t));
+      wheel_add_handles(w, old_max, w->max_handles);
+   }
+
+   struct entry e = {
+      .key    = key,
+      .user   = user,
+      .handle = w->free_handles[--(w->n_free)],
+      .seq    = 0
+   };
+
+   w->states[e.handle] = H_LIVE;
+
+   if (unlikely(key < w->base))
+      wheel_early_push(w, &e);
+   else
+      wheel_file(w, &e);
+   ++(w->size);
+
+   return e.handle;
+}
+
+void wheel_delete(wheel_t w, uint32_t handle)
+{
+   assert(handle < w->max_handles);
+   assert(w->states[handle] == H_LIVE);
+
+   w->states[handle] = H_DEAD;
+   --(w->size);
+}
+
+size_t wheel_size(wheel_t w)
+{
+   return w->size;
+}
+
+void wheel_walk(wheel_t w, wheel_walk_fn_t fn, void *context)
+{
+   for (uint32_t i = 0; i < w->early.count; i++) {
+      const struct entry *e = &(w->early.entries[i]);
+      if (w->states[e->handle] == H_LIVE)
+         (*fn)(e->key, e->user, context);
+   }
+
+   for (int level = 0; level < LEVELS; level++) {
+      for (int index = 0; index < SLOTS; index++) {
+         const struct slot *s = &(w->slots[level][index]);
+         for (uint32_t i = s->head; i < s->count; i++) {
+            const struct entry *e = &(s->entries[i]);
+            if (w->states[e->handle] == H_LIVE)
+               (*fn)(e->key, e->user, context);
+         }
+      }
+   }
+}
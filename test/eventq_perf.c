@@ -0,0 +1,185 @@
+#include "rt/heap.h"
+#include "rt/wheel.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+// Compare the binary heap and timing wheel event queues with a load
+// similar to a clocked testbench: a large number of events in flight,
+// each of which reschedules itself a few clock periods into the future
+
+#define N_EVENTS  (1 << 18)
+#define N_CYCLES  10000000
+#define PERIOD    (UINT64_C(10000000) << 2)   // 10 ns in heap_key units
+#define N_FAR     100000
+#define N_STEPS   1000000
+#define OUT_DELAY (UINT64_C(1000000) << 2)    // 1 ns in heap_key units
+
+static double now_secs(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint32_t rng_state;
+
+static uint32_t rng(void)
+{
+   // Cheap xorshift generator so random() does not dominate the timing
+   rng_state ^= rng_state << 13;
+   rng_state ^= rng_state >> 17;
+   rng_state ^= rng_state << 5;
+   return rng_state;
+}
+
+static uint64_t next_key(uint64_t now)
+{
+   // Mostly within a couple of clock periods with the occasional
+   // event much further in the future
+   if (rng() % 64 == 0)
+      return now + PERIOD * (1 + (rng() % 1000));
+   else
+      return now + PERIOD / 2 * (1 + (rng() % 4)) + (rng() % 4);
+}
+
+static void bench_heap(void)
+{
+   rng_state = 42;
+
+   heap_t h = heap_new(512);
+
+   for (int i = 0; i < N_EVENTS; i++) {
+      const uint64_t key = next_key(0);
+      heap_insert(h, key, (void *)(uintptr_t)key);
+   }
+
+   const double start = now_secs();
+
+   for (int i = 0; i < N_CYCLES; i++) {
+      const uint64_t now = (uintptr_t)heap_extract_min(h);
+      const uint64_t key = next_key(now);
+      heap_insert(h, key, (void *)(uintptr_t)key);
+   }
+
+   const double elapsed = now_secs() - start;
+   printf("heap:  %.1f Mevents/s\n", N_CYCLES / elapsed / 1e6);
+
+   heap_free(h);
+}
+
+static void bench_wheel(void)
+{
+   rng_state = 42;
+
+   wheel_t w = wheel_new();
+
+   for (int i = 0; i < N_EVENTS; i++) {
+      const uint64_t key = next_key(0);
+      wheel_insert(w, key, (void *)(uintptr_t)key);
+   }
+
+   const double start = now_secs();
+
+   for (int i = 0; i < N_CYCLES; i++) {
+      const uint64_t now = (uintptr_t)wheel_extract_min(w);
+      const uint64_t key = next_key(now);
+      wheel_insert(w, key, (void *)(uintptr_t)key);
+   }
+
+   const double elapsed = now_secs() - start;
+   printf("wheel: %.1f Mevents/s\n", N_CYCLES / elapsed / 1e6);
+
+   wheel_free(w);
+}
+
+// The kernel peeks at the next event at every time step and processes
+// running at that step may then schedule events before it. This models
+// a 10 ns clock driving an output after 1 ns with many events pending
+// far in the future.
+
+static void bench_heap_peek(void)
+{
+   heap_t h = heap_new(512);
+
+   for (int i = 0; i < N_FAR; i++) {
+      const uint64_t key = PERIOD * (N_STEPS + i);
+      heap_insert(h, key, (void *)(uintptr_t)key);
+   }
+
+   heap_insert(h, PERIOD / 2, (void *)(uintptr_t)(PERIOD / 2));
+
+   const double start = now_secs();
+
+   for (int i = 0; i < N_STEPS; i++) {
+      const uint64_t now = (uintptr_t)heap_extract_min(h);
+      const uint64_t peek = (uintptr_t)heap_min(h);
+
+      if (now % (PERIOD / 2) == 0) {
+         // Clock edge: schedule the output and the next edge
+         const uint64_t out = now + OUT_DELAY;
+         const uint64_t clk = now + PERIOD / 2;
+         if (out > peek)
+            abort();
+         heap_insert(h, out, (void *)(uintptr_t)out);
+         heap_insert(h, clk, (void *)(uintptr_t)clk);
+      }
+   }
+
+   const double elapsed = now_secs() - start;
+   printf("heap:  %.1f Mevents/s\n", N_STEPS / elapsed / 1e6);
+
+   heap_free(h);
+}
+
+static void bench_wheel_peek(void)
+{
+   wheel_t w = wheel_new();
+
+   for (int i = 0; i < N_FAR; i++) {
+      const uint64_t key = PERIOD * (N_STEPS + i);
+      wheel_insert(w, key, (void *)(uintptr_t)key);
+   }
+
+   wheel_insert(w, PERIOD / 2, (void *)(uintptr_t)(PERIOD / 2));
+
+   const double start = now_secs();
+
+   for (int i = 0; i < N_STEPS; i++) {
+      const uint64_t now = (uintptr_t)wheel_extract_min(w);
+      const uint64_t peek = (uintptr_t)wheel_min(w);
+
+      if (now % (PERIOD / 2) == 0) {
+         // Clock edge: schedule the output and the next edge
+         const uint64_t out = now + OUT_DELAY;
+         const uint64_t clk = now + PERIOD / 2;
+         if (out > peek)
+            abort();
+         wheel_insert(w, out, (void *)(uintptr_t)out);
+         wheel_insert(w, clk, (void *)(uintptr_t)clk);
+      }
+   }
+
+   const double elapsed = now_secs() - start;
+   printf("wheel: %.1f Mevents/s\n", N_STEPS / elapsed / 1e6);
+
+   wheel_free(w);
+}
+
+int main(int argc, char **argv)
+{
+   printf("%d events in flight, %d extract/insert pairs\n",
+          N_EVENTS, N_CYCLES);
+
+   bench_heap();
+   bench_wheel();
+
+   printf("%d events far in the future, %d peek then insert earlier "
+          "steps\n", N_FAR, N_STEPS);
+
+   bench_heap_peek();
+   bench_wheel_peek();
+
+   return 0;
+}
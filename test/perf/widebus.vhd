@@ -0,0 +1,63 @@
+-- Run with and without --pack-signals and --stats to compare the time
+-- and memory used by wide unresolved buses. The resolved std_logic bus
+-- is never packed and should be unaffected.
+
+entity widebus is
+end entity;
+
+library ieee;
+use ieee.std_logic_1164.all;
+
+architecture test of widebus is
+    constant WIDTH  : integer := 1024;
+    constant NBUSES : integer := 64;
+    constant CYCLES : integer := 20000;
+
+    subtype word is std_ulogic_vector(WIDTH - 1 downto 0);
+    type word_array is array (0 to NBUSES - 1) of word;
+
+    signal clk      : bit := '0';
+    signal buses    : word_array := (others => (others => '0'));
+    signal resolved : std_logic_vector(WIDTH - 1 downto 0);
+    signal changes  : natural;
+begin
+
+    clkgen: process is
+    begin
+        for i in 1 to CYCLES * 2 loop
+            clk <= not clk after 5 ns;
+            wait for 5 ns;
+        end loop;
+        report "changes " & integer'image(changes);
+        wait;
+    end process;
+
+    g: for i in buses'range generate
+
+        -- Shift a walking pattern through the bus but on odd buses
+        -- leave it unchanged every other edge so that some updates are
+        -- transactions without an event
+        shifter: process (clk) is
+            variable v    : word := (0 => '1', others => '0');
+            variable hold : boolean := false;
+        begin
+            if clk'event and clk = '1' then
+                if (i mod 2 = 0) or not hold then
+                    v := v(WIDTH - 2 downto 0) & v(WIDTH - 1);
+                end if;
+                hold := not hold;
+                buses(i) <= v;
+            end if;
+        end process;
+
+    end generate;
+
+    d1: resolved <= To_X01(buses(0)) when clk = '1' else (others => 'Z');
+    d2: resolved <= To_X01(buses(1)) when clk = '0' else (others => 'Z');
+
+    counter: process (buses(0), resolved) is
+    begin
+        changes <= changes + 1;
+    end process;
+
+end architecture;
@@ -0,0 +1,52 @@
+entity checkpoint1 is
+end entity;
+
+architecture test of checkpoint1 is
+    type int_vec is array (integer range <>) of integer;
+
+    signal clk : bit := '0';
+    signal cnt : int_vec(0 to 4) := (others => 0);
+begin
+
+    clkgen: process is
+    begin
+        for i in 1 to 20 loop
+            clk <= not clk after 5 ns;
+            wait for 5 ns;
+        end loop;
+        wait;
+    end process;
+
+    -- Several processes statically sensitive to the same signal
+    g: for i in 1 to 4 generate
+        static: process (clk) is
+            variable n : integer := 0;
+        begin
+            n := n + 1;
+            cnt(i) <= n;
+        end process;
+    end generate;
+
+    dynamic: process is
+        variable n : integer := 0;
+    begin
+        wait on clk;
+        n := n + 1;
+        cnt(0) <= n;
+    end process;
+
+    check: process is
+        variable total : integer := 0;
+    begin
+        wait for 110 ns;
+        assert cnt(0) = 20 report integer'image(cnt(0));
+        for i in 1 to 4 loop
+            -- Also run once at initialisation
+            assert cnt(i) = 21 report integer'image(cnt(i));
+            total := total + cnt(i);
+        end loop;
+        report "total " & integer'image(total + cnt(0));
+        wait;
+    end process;
+
+end architecture;
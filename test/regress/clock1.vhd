@@ -0,0 +1,57 @@
+entity clock1 is
+end entity;
+
+architecture test of clock1 is
+    signal clk  : bit := '0';
+    signal en   : boolean := false;
+    signal nr, nf, ne : natural;
+    signal last : bit;
+begin
+
+    -- Both of these are run directly by the kernel
+    clk <= not clk after 5 ns;
+
+    engen: process is
+    begin
+        en <= not en;
+        wait for 7 ns;
+    end process;
+
+    rising: process (clk) is
+    begin
+        if clk'event and clk = '1' then
+            assert clk'last_value = '0';
+            nr <= nr + 1;
+        end if;
+    end process;
+
+    falling: process is
+    begin
+        wait until clk = '0';
+        assert clk'last_value = '1';
+        last <= clk'last_value;
+        nf <= nf + 1;
+    end process;
+
+    enable: process (en) is
+    begin
+        if en'event then
+            ne <= ne + 1;
+        end if;
+    end process;
+
+    check: process is
+    begin
+        wait for 99 ns;
+        report integer'image(nr) & " " & integer'image(nf)
+            & " " & integer'image(ne);
+        assert nr = 10;
+        assert nf = 9;
+        assert ne = 15;
+        assert last = '1';
+        assert clk = '1';
+        assert en;
+        wait;
+    end process;
+
+end architecture;
@@ -0,0 +1,96 @@
+entity driver6 is
+end entity;
+
+library ieee;
+use ieee.std_logic_1164.all;
+
+architecture test of driver6 is
+
+    type bit_vec is array (integer range <>) of bit;
+
+    -- Looks like AND for two drivers but is not a fold of it
+    function majority (x : bit_vec) return bit is
+        variable count : integer := 0;
+    begin
+        for i in x'range loop
+            if x(i) = '1' then
+                count := count + 1;
+            end if;
+        end loop;
+        if count * 2 > x'length then
+            return '1';
+        else
+            return '0';
+        end if;
+    end function;
+
+    subtype maj_bit is majority bit;
+
+    type tri is ('0', '1', 'X');
+    type tri_vec is array (integer range <>) of tri;
+
+    -- A fold of OR with 'X' dominant for up to three drivers but 'X'
+    -- whenever four or more are present
+    function crowded (x : tri_vec) return tri is
+        variable r : tri := '0';
+    begin
+        if x'length >= 4 then
+            return 'X';
+        end if;
+        for i in x'range loop
+            if x(i) = 'X' or r = 'X' then
+                r := 'X';
+            elsif x(i) = '1' then
+                r := '1';
+            end if;
+        end loop;
+        return r;
+    end function;
+
+    subtype crowded_tri is crowded tri;
+
+    signal bus4 : std_logic_vector(7 downto 0);
+    signal m    : maj_bit;
+    signal c3   : crowded_tri;
+    signal c4   : crowded_tri;
+begin
+
+    d1: bus4 <= "ZZZZZZZZ", "0000ZZZZ" after 1 ns, "ZZZZZZZZ" after 3 ns;
+    d2: bus4 <= "ZZZZZZZZ", "ZZZZ1111" after 1 ns, "ZZZZZZZZ" after 3 ns;
+    d3: bus4 <= "HHHHLLLL", "HHHHZZZZ" after 2 ns;
+    d4: bus4 <= "ZZZZZZZZ", "Z1ZZZZ0Z" after 2 ns;
+
+    m1: m <= '1', '0' after 2 ns;
+    m2: m <= '1';
+    m3: m <= '0', '1' after 1 ns;
+
+    c3a: c3 <= '0', '1' after 1 ns;
+    c3b: c3 <= '0';
+    c3c: c3 <= '0';
+
+    c4a: c4 <= '0', '1' after 1 ns;
+    c4b: c4 <= '0';
+    c4c: c4 <= '0';
+    c4d: c4 <= '0';
+
+    check: process is
+    begin
+        wait for 0 ns;
+        assert bus4 = "HHHHLLLL";
+        assert m = '1';
+        assert c3 = '0';
+        assert c4 = 'X';
+        wait for 1 ns;
+        assert bus4 = "00001111";
+        assert m = '1';
+        assert c3 = '1';
+        assert c4 = 'X';
+        wait for 1 ns;
+        assert bus4 = "0X0011X1";
+        assert m = '1';
+        wait for 1 ns;
+        assert bus4 = "H1HHZZ0Z";
+        wait;
+    end process;
+
+end architecture;
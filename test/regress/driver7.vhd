@@ -0,0 +1,37 @@
+entity driver7 is
+end entity;
+
+library ieee;
+use ieee.std_logic_1164.all;
+
+architecture test of driver7 is
+    signal bus8 : std_logic_vector(7 downto 0);
+begin
+
+    -- Enough drivers on each net to use the driver index
+    g: for i in 0 to 7 generate
+        process is
+        begin
+            bus8 <= (others => 'Z');
+            wait for (i + 1) * 1 ns;
+            bus8(i) <= '1';
+            wait for 10 ns;
+            bus8(i) <= '0';
+            wait;
+        end process;
+    end generate;
+
+    check: process is
+    begin
+        wait for 1 ns;
+        assert bus8 = "ZZZZZZZ1";
+        wait for 7 ns;
+        assert bus8 = "11111111";
+        wait for 4 ns;
+        assert bus8 = "11111100";
+        wait for 10 ns;
+        assert bus8 = "00000000";
+        wait;
+    end process;
+
+end architecture;
@@ -0,0 +1,25 @@
+entity fork1 is
+end entity;
+
+use std.textio.all;
+
+architecture test of fork1 is
+begin
+
+    -- Run in a separate directory for each test by --fork-batch and
+    -- fails unless that directory has a value.txt containing 1
+    process is
+        file f     : text;
+        variable l : line;
+        variable v : integer;
+    begin
+        file_open(f, "value.txt", READ_MODE);
+        readline(f, l);
+        read(l, v);
+        file_close(f);
+        report "value " & integer'image(v);
+        assert v = 1;
+        wait;
+    end process;
+
+end architecture;
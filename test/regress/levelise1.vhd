@@ -0,0 +1,66 @@
+entity levelise1 is
+end entity;
+
+architecture test of levelise1 is
+    signal a, y  : bit := '0';
+    signal n     : bit_vector(1 to 7);
+    signal s, r  : bit := '0';
+    signal q     : bit := '0';
+    signal qn    : bit := '1';
+    signal n4_events : natural := 0;
+begin
+
+    -- Chain of inverters that should settle in one delta cycle
+    n(1) <= not a;
+    g: for i in 2 to 7 generate
+        n(i) <= not n(i - 1);
+    end generate;
+    y <= not n(7);
+
+    -- Not combinational so n(4) must still change in a delta cycle
+    watch: process (n(4)) is
+    begin
+        if n(4)'event then
+            n4_events <= n4_events + 1;
+        end if;
+    end process;
+
+    -- Set-reset latch is a loop so cannot be levelised
+    q  <= r nor qn;
+    qn <= s nor q;
+
+    stim: process is
+        variable deltas, base : natural;
+    begin
+        wait for 1 ns;
+        base := n4_events;
+        for i in 1 to 4 loop
+            a <= not a;
+            wait until a'event;
+            deltas := 0;
+            while y /= a loop
+                wait for 0 ns;
+                deltas := deltas + 1;
+            end loop;
+            -- One delta to reach n(4) and one for the rest of the chain
+            assert deltas = 2 report integer'image(deltas);
+            wait for 1 ns;
+        end loop;
+
+        assert n = "1010101";
+
+        s <= '1';
+        wait for 1 ns;
+        assert q = '1' and qn = '0';
+        s <= '0';
+        wait for 1 ns;
+        assert q = '1' and qn = '0';
+        r <= '1';
+        wait for 1 ns;
+        assert q = '0' and qn = '1';
+
+        assert n4_events = base + 4;
+        wait;
+    end process;
+
+end architecture;
@@ -0,0 +1,37 @@
+entity levelise2 is
+end entity;
+
+architecture test of levelise2 is
+    signal a, b, c : bit := '0';
+    signal clk     : bit := '0';
+    signal seen    : boolean := false;
+begin
+
+    -- Levelised chain where only b is read by nothing but the next gate
+    b <= a;
+    c <= b;
+
+    -- Not sensitive to c but samples it so c must change in a delta
+    -- cycle of its own rather than with b
+    sample: process (clk) is
+    begin
+        if clk'event and clk = '1' then
+            assert c = '1';
+            assert c'event report "c changed in an earlier cycle";
+            seen <= true;
+        end if;
+    end process;
+
+    stim: process is
+    begin
+        wait for 1 ns;
+        a <= '1';
+        wait for 0 ns;
+        -- The clock edge is in the same delta cycle as the update to c
+        clk <= '1';
+        wait for 1 ns;
+        assert seen;
+        wait;
+    end process;
+
+end architecture;
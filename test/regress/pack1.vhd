@@ -0,0 +1,52 @@
+entity pack1 is
+end entity;
+
+library ieee;
+use ieee.std_logic_1164.all;
+
+architecture test of pack1 is
+    type tri is ('a', 'b', 'c');
+    type tri_vec is array (natural range <>) of tri;
+
+    signal b  : bit_vector(15 downto 0) := X"00ff";
+    signal s  : std_logic_vector(11 downto 0) := (others => 'U');
+    signal t  : tri_vec(1 to 9) := (others => 'b');
+begin
+
+    -- Two drivers on the upper and lower halves of s
+    s(11 downto 4) <= "ZZZZZZZZ", "10HLZZZZ" after 1 ns;
+    s(11 downto 4) <= "ZZZZZZZZ", "ZZZZ1111" after 1 ns;
+    s(3 downto 0)  <= "0101";
+
+    stim: process is
+    begin
+        b <= X"1234";
+        t <= ('a', 'b', 'c', 'a', 'b', 'c', 'a', 'b', 'c');
+        wait for 1 ns;
+        b <= X"1234";                   -- Transaction but no event
+        wait for 1 ns;
+        b(3 downto 0) <= X"f";
+        wait;
+    end process;
+
+    check: process is
+    begin
+        wait for 0 ns;
+        assert b = X"1234";
+        assert b'last_value = X"00ff";
+        assert t(3) = 'c';
+        assert t'last_value(3) = 'b';
+        assert s = "ZZZZZZZZ0101";
+        wait for 1 ns;
+        assert s = "10HL1111" & "0101";
+        assert not b'event;
+        assert b'last_value = X"00ff";
+        wait on b;
+        assert now = 2 ns;
+        assert b = X"123f";
+        assert b'last_value = X"1234";
+        assert b'last_value(15 downto 8) = X"12";
+        wait;
+    end process;
+
+end architecture;
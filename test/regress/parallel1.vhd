@@ -0,0 +1,49 @@
+entity parallel1 is
+end entity;
+
+architecture test of parallel1 is
+    type int_vec is array (integer range <>) of integer;
+
+    signal clk   : bit := '0';
+    signal count : int_vec(0 to 15) := (others => 0);
+    signal total : int_vec(0 to 15) := (others => 0);
+begin
+
+    clkgen: process is
+    begin
+        for i in 1 to 10 loop
+            clk <= not clk after 5 ns;
+            wait for 5 ns;
+        end loop;
+        wait;
+    end process;
+
+    g: for i in count'range generate
+
+        counter: process (clk) is
+        begin
+            if clk'event and clk = '1' then
+                count(i) <= count(i) + i;
+            end if;
+        end process;
+
+        adder: process (count(i)) is
+            variable sum : integer := 0;
+        begin
+            sum := sum + count(i);
+            total(i) <= sum;
+        end process;
+
+    end generate;
+
+    check: process is
+    begin
+        wait for 100 ns;
+        for i in count'range loop
+            assert count(i) = 5 * i;
+            assert total(i) = 15 * i;
+        end loop;
+        wait;
+    end process;
+
+end architecture;
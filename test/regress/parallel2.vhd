@@ -0,0 +1,69 @@
+entity parallel2 is
+end entity;
+
+architecture test of parallel2 is
+    type int_vec is array (integer range <>) of integer;
+
+    -- Returns an unconstrained array so the result is allocated from
+    -- the temporary stack of the thread running the caller
+    function ramp (n, base : integer) return int_vec is
+        variable r : int_vec(1 to n);
+    begin
+        for i in r'range loop
+            r(i) := base + i;
+        end loop;
+        return r;
+    end function;
+
+    function sum (v : int_vec) return integer is
+        variable r : integer := 0;
+    begin
+        for i in v'range loop
+            r := r + v(i);
+        end loop;
+        return r;
+    end function;
+
+    signal clk   : bit := '0';
+    signal total : int_vec(0 to 15) := (others => 0);
+    signal width : int_vec(0 to 15) := (others => 0);
+begin
+
+    clkgen: process is
+    begin
+        for i in 1 to 10 loop
+            clk <= not clk after 5 ns;
+            wait for 5 ns;
+        end loop;
+        wait;
+    end process;
+
+    g: for i in total'range generate
+
+        worker: process (clk) is
+        begin
+            if clk'event and clk = '1' then
+                total(i) <= total(i) + sum(ramp(i + 1, i) & ramp(i, 0));
+                width(i) <= integer'image(total(i))'length;
+            end if;
+        end process;
+
+    end generate;
+
+    check: process is
+        -- sum(ramp(n, base)) = n * base + n * (n + 1) / 2
+        function expect (i : integer) return integer is
+        begin
+            return (i + 1) * i + (i + 1) * (i + 2) / 2 + i * (i + 1) / 2;
+        end function;
+    begin
+        wait for 100 ns;
+        for i in total'range loop
+            assert total(i) = 5 * expect(i)
+                report integer'image(i) & ": " & integer'image(total(i));
+            assert width(i) = integer'image(4 * expect(i))'length;
+        end loop;
+        wait;
+    end process;
+
+end architecture;
@@ -0,0 +1,44 @@
+entity parallel3 is
+end entity;
+
+architecture test of parallel3 is
+    type int_vec is array (integer range <>) of integer;
+
+    -- Called on the update worker threads when enough resolved signals
+    -- change in the same cycle
+    function check_equal (x : int_vec) return integer is
+    begin
+        if x(x'left) = 20 then
+            report "value 20";
+        end if;
+        assert x(x'left) = x(x'right)
+            report "conflict " & integer'image(x(x'right))
+            severity failure;
+        return x(x'left);
+    end function;
+
+    subtype rint is check_equal integer;
+
+    signal a, b : int_vec(0 to 79) := (others => 0);
+begin
+
+    g: for i in 0 to 79 generate
+        signal s : rint;
+    begin
+        s <= a(i);
+        s <= b(i);
+    end generate;
+
+    stim: process is
+        variable v : int_vec(0 to 79);
+    begin
+        for i in v'range loop
+            v(i) := i;
+        end loop;
+        a <= v after 1 ns;
+        v(37) := 99;
+        b <= v after 1 ns;
+        wait;
+    end process;
+
+end architecture;
@@ -0,0 +1,56 @@
+entity signal14 is
+end entity;
+
+library ieee;
+use ieee.std_logic_1164.all;
+
+architecture test of signal14 is
+    signal s      : std_logic;
+    signal events : natural := 0;
+begin
+
+    -- Both drivers change in the same delta cycle but the resolved
+    -- value stays the same so there is no event on s
+    p1: process is
+    begin
+        s <= 'Z';
+        wait for 1 ns;
+        s <= '1';
+        wait for 1 ns;
+        s <= '0';
+        wait;
+    end process;
+
+    p2: process is
+    begin
+        s <= '1';
+        wait for 1 ns;
+        s <= 'Z';
+        wait for 1 ns;
+        s <= 'Z';
+        wait;
+    end process;
+
+    count: process (s) is
+    begin
+        events <= events + 1;
+    end process;
+
+    check: process is
+    begin
+        wait for 0 ns;
+        assert s = '1';
+        wait for 1 ns;
+        wait for 0 ns;
+        assert s = '1';
+        assert not s'event;
+        assert events = 2;
+        wait for 1 ns;
+        wait for 0 ns;
+        assert s = '0';
+        wait for 0 ns;
+        assert events = 3;
+        wait;
+    end process;
+
+end architecture;
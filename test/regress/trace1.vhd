@@ -0,0 +1,27 @@
+entity trace1 is
+end entity;
+
+architecture test of trace1 is
+    signal x, y, z : bit;
+begin
+
+    -- Only records for p1 and x are written to the trace
+
+    p1: process is
+    begin
+        wait for 1 ns;
+        x <= '1';
+        y <= '1';
+        wait for 1 ns;
+        x <= '0';
+        wait;
+    end process;
+
+    p2: process is
+    begin
+        wait for 1 ns;
+        z <= '1';
+        wait;
+    end process;
+
+end architecture;
@@ -0,0 +1,62 @@
+entity wait14 is
+end entity;
+
+architecture test of wait14 is
+    signal r, q : bit_vector(0 to 99);
+    signal nr, nq, nb : natural;
+begin
+
+    -- Each signal is driven in pieces by two processes so is split into
+    -- several groups
+
+    stim1: process is
+    begin
+        wait for 1 ns;
+        r(0 to 9) <= (others => '1');
+        wait for 2 ns;
+        r(0 to 9) <= (others => '0');
+        wait for 1 ns;
+        q(50 to 99) <= (others => '1');
+        wait;
+    end process;
+
+    stim2: process is
+    begin
+        wait for 2 ns;
+        r(10 to 99) <= (others => '1');
+        q(0 to 49) <= (others => '1');
+        wait for 1 ns;
+        r(10 to 99) <= (others => '0');
+        wait;
+    end process;
+
+    wr: process is
+    begin
+        wait on r;
+        nr <= nr + 1;
+    end process;
+
+    wq: process is
+    begin
+        wait on q;
+        nq <= nq + 1;
+    end process;
+
+    wb: process is
+    begin
+        wait on r, q;
+        nb <= nb + 1;
+    end process;
+
+    check: process is
+    begin
+        wait for 5 ns;
+        report integer'image(nr) & " " & integer'image(nq)
+            & " " & integer'image(nb);
+        assert nr = 3;
+        assert nq = 2;
+        assert nb = 4;
+        wait;
+    end process;
+
+end architecture;
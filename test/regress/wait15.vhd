@@ -0,0 +1,72 @@
+entity wait15 is
+end entity;
+
+architecture test of wait15 is
+    -- Each signal is driven in pieces by two processes so is split into
+    -- several groups. The lengths are chosen so that b and c likely
+    -- cross the boundaries between blocks of 4096 and 64 nets.
+    signal a : bit_vector(0 to 4089);
+    signal b : bit_vector(0 to 9);
+    signal c : bit_vector(0 to 99);
+    signal na, nb, nc, nall : natural;
+begin
+
+    stim1: process is
+    begin
+        wait for 1 ns;
+        b(0 to 4) <= (others => '1');
+        wait for 1 ns;
+        c(0 to 49) <= (others => '1');
+        wait for 1 ns;
+        a(0) <= '1';
+        wait;
+    end process;
+
+    stim2: process is
+    begin
+        wait for 5 ns;
+        b(5 to 9) <= (others => '1');
+        wait for 1 ns;
+        c(50 to 99) <= (others => '1');
+        wait for 1 ns;
+        a(1 to 4089) <= (others => '1');
+        wait;
+    end process;
+
+    wa: process is
+    begin
+        wait on a;
+        na <= na + 1;
+    end process;
+
+    wb: process is
+    begin
+        wait on b;
+        nb <= nb + 1;
+    end process;
+
+    wc: process is
+    begin
+        wait on c;
+        nc <= nc + 1;
+    end process;
+
+    wall: process is
+    begin
+        wait on a, b, c;
+        nall <= nall + 1;
+    end process;
+
+    check: process is
+    begin
+        wait for 10 ns;
+        report integer'image(na) & " " & integer'image(nb)
+            & " " & integer'image(nc) & " " & integer'image(nall);
+        assert na = 2;
+        assert nb = 2;
+        assert nc = 2;
+        assert nall = 6;
+        wait;
+    end process;
+
+end architecture;
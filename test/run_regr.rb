@@ -77,10 +77,42 @@ def run(t)
   cmd = "#{nvc} #{std t} -r"
   t[:flags].each do |f|
     cmd += " --stop-time=#{Regexp.last_match(1)}" if f =~ /stop=(.*)/
+    cmd += " --threads=#{Regexp.last_match(1)}" if f =~ /threads=(.*)/
+    cmd += " --pack-signals" if f == 'pack'
+    cmd += " --levelise" if f == 'levelise'
     cmd += " --load=#{BuildDir}/lib/#{t[:name]}.so" if f == 'vhpi'
+    cmd += " --trace-file=#{t[:name]}.trace" if f == 'trace'
+    if f =~ /trace-(proc|signal)=(.*)/ then
+      cmd += " --trace-#{Regexp.last_match(1)}='#{Regexp.last_match(2)}'"
+    end
+  end
+  t[:flags].each do |f|
+    if f =~ /restore=(.*)/ then
+      # Run to completion taking a checkpoint and then resume from it
+      ckpt = "#{t[:name]}.checkpoint"
+      run_cmd "#{cmd} --checkpoint-at=#{Regexp.last_match(1)} " +
+        "--checkpoint=#{ckpt} #{t[:name]}"
+      cmd += " --restore=#{ckpt}"
+    end
+  end
+  if t[:flags].member? 'fork' then
+    # One directory where the test passes and one where it fails
+    File.open("#{t[:name]}.list", 'w') do |list|
+      { 'pass' => 1, 'fail' => 0 }.each do |dir, value|
+        mkdir_p "#{t[:name]}.#{dir}"
+        File.open("#{t[:name]}.#{dir}/value.txt", 'w') do |f|
+          f.puts value
+        end
+        list.puts "#{t[:name]}.#{dir}"
+      end
+    end
+    cmd += " --fork-batch=#{t[:name]}.list --jobs=1"
   end
   cmd += " #{t[:name]}"
   run_cmd cmd, t[:flags].member?('fail')
+  if t[:flags].member? 'trace' then
+    run_cmd "#{nvc} --decode-trace --csv #{t[:name]}.trace"
+  end
 end
 
 def check(t)
@@ -92,6 +124,16 @@ def check(t)
     end
     ptr = 0
     File.open(fname).each_line do |match_line|
+      if match_line.start_with? '!' then
+        # Must not appear anywhere in the output
+        never = match_line[1..-1].chomp
+        if out_lines.any? { |l| l.include? never } then
+          puts "failed (unexpected match)".red
+          print never
+          return false
+        end
+        next
+      end
       loop do
         if ptr == out_lines.size then
           puts "failed (no match)".red
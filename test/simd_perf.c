@@ -0,0 +1,101 @@
+#include "rt/simd.h"
+#include "rt/rt.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+// Compare the scalar and vector kernels used for signal resolution and
+// bit vector operations across a range of vector widths. The lookup
+// tables are sized for std_ulogic.
+
+#define N_LITS   9
+#define N_MAX    4096
+#define N_ELEMS  (UINT64_C(1) << 28)
+
+static uint8_t a[N_MAX], b[N_MAX], out[N_MAX];
+static uint8_t tab1[N_LITS], tab2[N_LITS * N_LITS];
+
+static double now_secs(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+typedef enum { K_LOOKUP1, K_LOOKUP2, K_AND, K_XOR, K_NOT } kernel_t;
+
+static double bench(kernel_t k, size_t n)
+{
+   const uint64_t iters = N_ELEMS / n;
+
+   const double start = now_secs();
+
+   for (uint64_t i = 0; i < iters; i++) {
+      switch (k) {
+      case K_LOOKUP1:
+         simd_lookup1(out, a, n, tab1, N_LITS);
+         break;
+      case K_LOOKUP2:
+         simd_lookup2(out, a, b, n, tab2, N_LITS);
+         break;
+      case K_AND:
+         simd_bit_vec_op(BIT_VEC_AND, out, out, b, n);
+         break;
+      case K_XOR:
+         simd_bit_vec_op(BIT_VEC_XOR, out, out, b, n);
+         break;
+      case K_NOT:
+         simd_bit_vec_op(BIT_VEC_NOT, out, out, NULL, n);
+         break;
+      }
+
+      // Stop the compiler hoisting the kernel out of the loop
+      __asm__ volatile ("" : : "r" (out) : "memory");
+   }
+
+   return (now_secs() - start) * 1e9 / (iters * n);
+}
+
+int main(int argc, char **argv)
+{
+   const simd_level_t best = simd_init();
+
+   for (int i = 0; i < N_MAX; i++) {
+      a[i] = random() % N_LITS;
+      b[i] = random() % 2;
+   }
+
+   for (int i = 0; i < N_LITS; i++)
+      tab1[i] = random() % N_LITS;
+   for (int i = 0; i < N_LITS * N_LITS; i++)
+      tab2[i] = random() % N_LITS;
+
+   printf("ns/element for scalar -> %s kernels\n", simd_level_str(best));
+
+   const char *names[] = { "lookup1", "lookup2", "and", "xor", "not" };
+
+   printf("%6s", "width");
+   for (int k = 0; k < 5; k++)
+      printf(" %17s", names[k]);
+   printf("\n");
+
+   for (size_t n = 8; n <= N_MAX; n *= 2) {
+      printf("%6zu", n);
+      for (kernel_t k = K_LOOKUP1; k <= K_NOT; k++) {
+         memset(out, '\0', n);
+
+         simd_set_level(SIMD_SCALAR);
+         const double scalar = bench(k, n);
+
+         simd_set_level(best);
+         const double vector = bench(k, n);
+
+         printf("  %6.3f -> %6.3f", scalar, vector);
+      }
+      printf("\n");
+   }
+
+   return 0;
+}
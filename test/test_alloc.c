@@ -0,0 +1,149 @@
+#include "rt/alloc.h"
+
+#include <check.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#define NITEMS 1000
+
+static void teardown(void)
+{
+   rt_slab_destroy();
+}
+
+static size_t capacity(rt_alloc_stack_t s)
+{
+   return s->stack_sz;
+}
+
+static size_t used(rt_alloc_stack_t s)
+{
+   return s->stack_sz - s->stack_top;
+}
+
+START_TEST(test_class)
+{
+   rt_alloc_stack_t s = rt_slab_class(20);
+   fail_if(s == NULL);
+   fail_unless(s->item_sz == 24);
+   fail_unless(rt_slab_class(24) == s);
+   fail_if(rt_slab_class(25) == s);
+   fail_unless(rt_slab_class(1) == rt_slab_class(8));
+   fail_unless(rt_slab_class(4096) != NULL);
+   fail_unless(rt_slab_class(4097) == NULL);
+}
+END_TEST
+
+START_TEST(test_peak)
+{
+   rt_alloc_stack_t s = rt_slab_class(24);
+
+   void *items[NITEMS];
+   for (int i = 0; i < NITEMS; i++) {
+      items[i] = rt_alloc(s);
+      fail_if(items[i] == NULL);
+   }
+
+   fail_unless(used(s) == NITEMS);
+   fail_unless(capacity(s) == 1024);
+   fail_unless(rt_alloc_stack_hwm(s) == NITEMS);
+
+   for (int i = 0; i < NITEMS; i++)
+      rt_free(s, items[i]);
+
+   fail_unless(used(s) == 0);
+   fail_unless(rt_alloc_stack_hwm(s) == NITEMS);
+
+   // Items freed since the last trim are not released as they may be
+   // needed again soon
+   fail_unless(rt_alloc_stack_trim(s) == 0);
+   fail_unless(capacity(s) == 1024);
+   fail_unless(s->trimmed == 0);
+
+   // Now nothing has been used since the last trim
+   fail_unless(rt_alloc_stack_trim(s) == 1024);
+   fail_unless(capacity(s) == 0);
+   fail_unless(s->trimmed == 1024);
+   fail_unless(rt_alloc_stack_hwm(s) == NITEMS);
+
+   // The class can still allocate after releasing everything
+   void *p = rt_alloc(s);
+   fail_if(p == NULL);
+   fail_unless(capacity(s) == 128);
+   rt_free(s, p);
+}
+END_TEST
+
+START_TEST(test_trim_partial)
+{
+   rt_alloc_stack_t s = rt_slab_class(64);
+
+   void *items[NITEMS];
+   for (int i = 0; i < NITEMS; i++)
+      items[i] = rt_alloc(s);
+
+   // Keep some items from the first chunk allocated
+   for (int i = 100; i < NITEMS; i++)
+      rt_free(s, items[i]);
+
+   fail_unless(used(s) == 100);
+
+   fail_unless(rt_alloc_stack_trim(s) == 0);
+   fail_unless(capacity(s) == 1024);
+
+   // Every chunk except the first is entirely free
+   fail_unless(rt_alloc_stack_trim(s) == 896);
+   fail_unless(capacity(s) == 128);
+   fail_unless(used(s) == 100);
+   fail_unless(s->trimmed == 896);
+   fail_unless(rt_alloc_stack_hwm(s) == NITEMS);
+
+   // Nothing more can be released while those items are in use
+   fail_unless(rt_alloc_stack_trim(s) == 0);
+   fail_unless(capacity(s) == 128);
+
+   for (int i = 0; i < 100; i++)
+      rt_free(s, items[i]);
+
+   fail_unless(used(s) == 0);
+}
+END_TEST
+
+START_TEST(test_reuse)
+{
+   rt_alloc_stack_t s = rt_slab_class(8);
+
+   // Freed items are handed out again before the class grows
+   for (int i = 0; i < NITEMS; i++) {
+      void *p = rt_alloc(s);
+      rt_free(s, p);
+      fail_unless(rt_alloc(s) == p);
+      rt_free(s, p);
+   }
+
+   fail_unless(capacity(s) == 128);
+   fail_unless(rt_alloc_stack_hwm(s) == 1);
+}
+END_TEST
+
+int main(void)
+{
+   Suite *s = suite_create("alloc");
+
+   TCase *tc_core = tcase_create("Core");
+   tcase_add_checked_fixture(tc_core, NULL, teardown);
+   tcase_add_test(tc_core, test_class);
+   tcase_add_test(tc_core, test_peak);
+   tcase_add_test(tc_core, test_trim_partial);
+   tcase_add_test(tc_core, test_reuse);
+   suite_add_tcase(s, tc_core);
+
+   SRunner *sr = srunner_create(s);
+   srunner_run_all(sr, CK_NORMAL);
+
+   int nfail = srunner_ntests_failed(sr);
+
+   srunner_free(sr);
+
+   return nfail == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
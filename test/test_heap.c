@@ -82,6 +82,25 @@ START_TEST(test_rand)
 }
 END_TEST
 
+START_TEST(test_delete)
+{
+   uint32_t handles[100];
+   for (int i = 0; i < 100; i++)
+      handles[i] = heap_insert(h, i * 7, (void*)(uintptr_t)(i * 7));
+
+   // Delete every odd element
+   for (int i = 1; i < 100; i += 2)
+      heap_delete(h, handles[i]);
+
+   fail_unless(heap_size(h) == 50);
+
+   for (int i = 0; i < 100; i += 2)
+      fail_unless(heap_extract_min(h) == (void*)(uintptr_t)(i * 7));
+
+   fail_unless(heap_size(h) == 0);
+}
+END_TEST
+
 int main(void)
 {
    srandom((unsigned)time(NULL));
@@ -93,6 +112,7 @@ int main(void)
    tcase_add_test(tc_core, test_basic);
    tcase_add_test(tc_core, test_rand);
    tcase_add_test(tc_core, test_walk);
+   tcase_add_test(tc_core, test_delete);
    suite_add_tcase(s, tc_core);
 
    SRunner *sr = srunner_create(s);
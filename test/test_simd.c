@@ -0,0 +1,137 @@
+#include "rt/simd.h"
+#include "rt/rt.h"
+
+#include <check.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define N_MAX 1000
+
+static uint8_t tab1[256];
+static uint8_t tab2[256 * 256];
+
+static void fill_random(uint8_t *p, size_t n, unsigned range)
+{
+   for (size_t i = 0; i < n; i++)
+      p[i] = random() % range;
+}
+
+static void check_lookup(unsigned nlits)
+{
+   uint8_t a[N_MAX], b[N_MAX], out[N_MAX], inplace[N_MAX];
+
+   fill_random(tab1, nlits, nlits);
+   fill_random(tab2, nlits * nlits, nlits);
+
+   for (size_t n = 0; n < N_MAX; n += 1 + (n / 8)) {
+      fill_random(a, n, nlits);
+      fill_random(b, n, nlits);
+
+      simd_lookup1(out, a, n, tab1, nlits);
+      for (size_t i = 0; i < n; i++)
+         fail_unless(out[i] == tab1[a[i]]);
+
+      simd_lookup2(out, a, b, n, tab2, nlits);
+      for (size_t i = 0; i < n; i++)
+         fail_unless(out[i] == tab2[(a[i] * nlits) + b[i]]);
+
+      memcpy(inplace, a, n);
+      simd_lookup2(inplace, inplace, b, n, tab2, nlits);
+      fail_if(memcmp(inplace, out, n) != 0);
+   }
+}
+
+static uint8_t bit_op_ref(int kind, uint8_t x, uint8_t y)
+{
+   switch (kind) {
+   case BIT_VEC_NOT:  return !x;
+   case BIT_VEC_AND:  return x && y;
+   case BIT_VEC_OR:   return x || y;
+   case BIT_VEC_XOR:  return x ^ y;
+   case BIT_VEC_XNOR: return !(x ^ y);
+   case BIT_VEC_NAND: return !(x && y);
+   case BIT_VEC_NOR:  return !(x || y);
+   default: return 0xff;
+   }
+}
+
+static void check_bit_vec_op(void)
+{
+   uint8_t a[N_MAX], b[N_MAX], out[N_MAX];
+
+   for (int kind = BIT_VEC_NOT; kind <= BIT_VEC_NOR; kind++) {
+      for (size_t n = 0; n < N_MAX; n += 1 + (n / 8)) {
+         fill_random(a, n, 2);
+         fill_random(b, n, 2);
+
+         simd_bit_vec_op(kind, out, a,
+                         (kind == BIT_VEC_NOT) ? NULL : b, n);
+
+         for (size_t i = 0; i < n; i++)
+            fail_unless(out[i] == bit_op_ref(kind, a[i], b[i]));
+      }
+   }
+}
+
+START_TEST(test_lookup)
+{
+   const simd_level_t max = simd_init();
+
+   for (simd_level_t l = SIMD_SCALAR; l <= max; l++) {
+      fail_unless(simd_set_level(l) == l);
+
+      check_lookup(2);
+      check_lookup(9);
+      check_lookup(16);
+      check_lookup(17);
+      check_lookup(200);
+   }
+}
+END_TEST
+
+START_TEST(test_bit_vec)
+{
+   const simd_level_t max = simd_init();
+
+   for (simd_level_t l = SIMD_SCALAR; l <= max; l++) {
+      fail_unless(simd_set_level(l) == l);
+      check_bit_vec_op();
+   }
+}
+END_TEST
+
+START_TEST(test_level)
+{
+   const simd_level_t max = simd_init();
+
+   // Requests beyond what the CPU supports are clamped
+   fail_unless(simd_set_level(SIMD_AVX2) == max);
+   fail_unless(simd_set_level(SIMD_SCALAR) == SIMD_SCALAR);
+
+   fail_if(strcmp(simd_level_str(SIMD_SCALAR), "scalar") != 0);
+}
+END_TEST
+
+int main(void)
+{
+   srandom((unsigned)time(NULL));
+
+   Suite *s = suite_create("simd");
+
+   TCase *tc_core = tcase_create("Core");
+   tcase_add_test(tc_core, test_lookup);
+   tcase_add_test(tc_core, test_bit_vec);
+   tcase_add_test(tc_core, test_level);
+   suite_add_tcase(s, tc_core);
+
+   SRunner *sr = srunner_create(s);
+   srunner_run_all(sr, CK_NORMAL);
+
+   int nfail = srunner_ntests_failed(sr);
+
+   srunner_free(sr);
+
+   return nfail == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
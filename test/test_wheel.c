@@ -0,0 +1,253 @@
+#include "rt/wheel.h"
+
+#include <check.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+static wheel_t w = NULL;
+
+static void setup(void)
+{
+   w = wheel_new();
+}
+
+static void teardown(void)
+{
+   wheel_free(w);
+   w = NULL;
+}
+
+static int magnitude_compar(const void *a, const void *b)
+{
+   const uintptr_t ka = *(const uintptr_t*)a;
+   const uintptr_t kb = *(const uintptr_t*)b;
+   return (ka > kb) - (ka < kb);
+}
+
+static void walk_fn(uint64_t key, void *user, void *context)
+{
+   int *count = context;
+
+   fail_if(key != (uintptr_t)user);
+
+   (*count)++;
+}
+
+START_TEST(test_basic)
+{
+   wheel_insert(w, 5, (void*)5);
+   wheel_insert(w, 2, (void*)2);
+   wheel_insert(w, 62, (void*)62);
+
+   fail_unless(wheel_size(w) == 3);
+
+   fail_unless(wheel_min(w) == (void*)2);
+
+   fail_unless(wheel_extract_min(w) == (void*)2);
+   fail_unless(wheel_extract_min(w) == (void*)5);
+   fail_unless(wheel_extract_min(w) == (void*)62);
+
+   fail_unless(wheel_size(w) == 0);
+}
+END_TEST
+
+START_TEST(test_walk)
+{
+   wheel_insert(w, 5, (void*)5);
+   wheel_insert(w, 2, (void*)2);
+   wheel_insert(w, 62000, (void*)62000);
+
+   int count = 0;
+   wheel_walk(w, walk_fn, &count);
+
+   fail_unless(count == 3);
+}
+END_TEST
+
+START_TEST(test_rand)
+{
+   static const int N = 1024;
+   uintptr_t keys[N];
+
+   for (int i = 0; i < N; i++) {
+      keys[i] = random();
+      wheel_insert(w, keys[i], (void*)keys[i]);
+   }
+
+   qsort(keys, N, sizeof(uintptr_t), magnitude_compar);
+
+   for (int i = 0; i < N; i++)
+      fail_unless(wheel_extract_min(w) == (void*)keys[i]);
+}
+END_TEST
+
+START_TEST(test_fifo)
+{
+   // Elements with equal keys come out in insertion order
+   wheel_insert(w, 1000, (void*)1);
+   wheel_insert(w, 1000, (void*)2);
+   wheel_insert(w, 10, (void*)3);
+   wheel_insert(w, 1000, (void*)4);
+
+   fail_unless(wheel_extract_min(w) == (void*)3);
+   fail_unless(wheel_extract_min(w) == (void*)1);
+   fail_unless(wheel_extract_min(w) == (void*)2);
+   fail_unless(wheel_extract_min(w) == (void*)4);
+}
+END_TEST
+
+START_TEST(test_rewind)
+{
+   wheel_insert(w, 100, (void*)100);
+   wheel_insert(w, 1 << 20, (void*)(1 << 20));
+
+   fail_unless(wheel_extract_min(w) == (void*)100);
+
+   // Peeking cascades the base forwards past 200 so this is an early
+   // entry
+   fail_unless(wheel_min(w) == (void*)(1 << 20));
+
+   wheel_insert(w, 200, (void*)200);
+
+   fail_unless(wheel_extract_min(w) == (void*)200);
+   fail_unless(wheel_extract_min(w) == (void*)(1 << 20));
+}
+END_TEST
+
+START_TEST(test_peek_insert)
+{
+   // The kernel peeks at every time step and then schedules events
+   // before the one it found: these must be cheap and ordered correctly
+   wheel_insert(w, 1 << 30, (void*)(1 << 30));
+   wheel_insert(w, 10, (void*)10);
+
+   uint64_t now = (uintptr_t)wheel_extract_min(w);
+   fail_unless(now == 10);
+
+   for (int i = 0; i < 1000; i++) {
+      fail_unless(wheel_min(w) == (void*)(1 << 30));
+
+      const uintptr_t out = now + 1 + (i % 7);
+      wheel_insert(w, out, (void*)out);
+      fail_unless(wheel_min(w) == (void*)out);
+
+      const uintptr_t later = out + 3;
+      wheel_insert(w, later, (void*)later);
+      fail_unless(wheel_min(w) == (void*)out);
+
+      fail_unless(wheel_extract_min(w) == (void*)out);
+      fail_unless(wheel_extract_min(w) == (void*)later);
+      now = later;
+   }
+
+   fail_unless(wheel_extract_min(w) == (void*)(1 << 30));
+   fail_unless(wheel_size(w) == 0);
+}
+END_TEST
+
+START_TEST(test_peek_delete)
+{
+   const uint32_t h = wheel_insert(w, 5000, (void*)5000);
+   wheel_insert(w, 7000, (void*)7000);
+
+   fail_unless(wheel_min(w) == (void*)5000);
+   wheel_delete(w, h);
+   fail_unless(wheel_min(w) == (void*)7000);
+   fail_unless(wheel_extract_min(w) == (void*)7000);
+}
+END_TEST
+
+START_TEST(test_early_fifo)
+{
+   wheel_insert(w, 1 << 20, (void*)1);
+   fail_unless(wheel_min(w) == (void*)1);
+
+   for (uintptr_t i = 2; i < 100; i++)
+      wheel_insert(w, 500 + (i % 3), (void*)i);
+
+   for (uintptr_t k = 0; k < 3; k++) {
+      for (uintptr_t i = 2; i < 100; i++) {
+         if (i % 3 == k)
+            fail_unless(wheel_extract_min(w) == (void*)i);
+      }
+   }
+
+   fail_unless(wheel_extract_min(w) == (void*)1);
+   fail_unless(wheel_size(w) == 0);
+}
+END_TEST
+
+START_TEST(test_interleave)
+{
+   static const int N = 10000;
+   uint64_t now = 0;
+
+   for (int i = 0; i < N; i++) {
+      const uintptr_t key = now + 1 + (random() % 5000);
+      wheel_insert(w, key, (void*)key);
+
+      if (i % 3 == 2) {
+         const uintptr_t next = (uintptr_t)wheel_extract_min(w);
+         fail_if(next < now);
+         now = next;
+      }
+   }
+
+   while (wheel_size(w) > 0) {
+      const uintptr_t next = (uintptr_t)wheel_extract_min(w);
+      fail_if(next < now);
+      now = next;
+   }
+}
+END_TEST
+
+START_TEST(test_delete)
+{
+   uint32_t handles[100];
+   for (int i = 0; i < 100; i++)
+      handles[i] = wheel_insert(w, i * 7, (void*)(uintptr_t)(i * 7));
+
+   // Delete every odd element
+   for (int i = 1; i < 100; i += 2)
+      wheel_delete(w, handles[i]);
+
+   fail_unless(wheel_size(w) == 50);
+
+   for (int i = 0; i < 100; i += 2)
+      fail_unless(wheel_extract_min(w) == (void*)(uintptr_t)(i * 7));
+
+   fail_unless(wheel_size(w) == 0);
+}
+END_TEST
+
+int main(void)
+{
+   srandom((unsigned)time(NULL));
+
+   Suite *s = suite_create("wheel");
+
+   TCase *tc_core = tcase_create("Core");
+   tcase_add_checked_fixture(tc_core, setup, teardown);
+   tcase_add_test(tc_core, test_basic);
+   tcase_add_test(tc_core, test_rand);
+   tcase_add_test(tc_core, test_walk);
+   tcase_add_test(tc_core, test_delete);
+   tcase_add_test(tc_core, test_fifo);
+   tcase_add_test(tc_core, test_rewind);
+   tcase_add_test(tc_core, test_interleave);
+   tcase_add_test(tc_core, test_peek_insert);
+   tcase_add_test(tc_core, test_peek_delete);
+   tcase_add_test(tc_core, test_early_fifo);
+   suite_add_tcase(s, tc_core);
+
+   SRunner *sr = srunner_create(s);
+   srunner_run_all(sr, CK_NORMAL);
+
+   int nfail = srunner_ntests_failed(sr);
+
+   srunner_free(sr);
+
+   return nfail == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}